@@ -0,0 +1,382 @@
+/** @file
+ * Implementacja równoległego budowania drzew przekierowań numerów telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "build.h"
+
+/**
+ * Liczba części przekierowań z numerów mających co najmniej dwie cyfry.
+ */
+#define LONG_PARTS (DIGITS * DIGITS)
+
+/**
+ * Liczba wszystkich części: dodatkowo po jednej dla numerów jednocyfrowych.
+ */
+#define PARTS (LONG_PARTS + DIGITS)
+
+/**
+ * Oznaczenie pominiętego przekierowania.
+ */
+#define SKIPPED UCHAR_MAX
+
+/**
+ * To jest struktura opisująca jedną część budowanych drzew.
+ */
+typedef struct Part {
+    size_t *indices; ///< indeksy przekierowań części drzewa @p from
+    size_t count;    ///< liczba indeksów
+    Node **nodes;    ///< węzły z przekierowaniami części drzewa @p to
+    size_t size;     ///< rozmiar tablicy @p nodes
+    size_t last;     ///< liczba węzłów
+    Node *top;       ///< zbudowane poddrzewo na głębokości 2 lub NULL
+} Part;
+
+/**
+ * To jest struktura przechowująca stan budowania wspólny dla wątków.
+ */
+typedef struct Build {
+    Node *root;               ///< korzeń drzewa budowanego w danym etapie
+    char const *const *num1s; ///< numery przekierowywane
+    char const *const *num2s; ///< numery docelowe
+    Part *parts;              ///< części budowanego drzewa
+    /** Funkcja budująca jedną część drzewa. */
+    bool (*work)(struct Build *build, Part *part, size_t key, Memory *memory);
+    atomic_size_t next;       ///< numer następnej części do zbudowania
+    atomic_bool failed;       ///< czy nie udało się alokować pamięci
+} Build;
+
+/**
+ * To jest struktura przechowująca stan jednego wątku budującego drzewo.
+ */
+typedef struct Worker {
+    Build *build;  ///< stan budowania wspólny dla wątków
+    Memory memory; ///< pamięć przydzielona przez wątek
+} Worker;
+
+/** @brief Wyznacza część, do której należy numer.
+ * @param[in] num – wskaźnik na niepusty numer.
+ * @return Numer części.
+ */
+static size_t partOf(char const *num) {
+    if (num[1] == '\0')
+        return LONG_PARTS + digitFinder(num[0]);
+    return digitFinder(num[0]) * DIGITS + digitFinder(num[1]);
+}
+
+/** @brief Wyznacza część, do której należy spakowany numer.
+ * @param[in] num – wskaźnik na niepusty spakowany numer.
+ * @return Numer części.
+ */
+static size_t partOfNumber(Number const *num) {
+    if (numberLength(num) == 1)
+        return LONG_PARTS + numberDigit(num, 0);
+    return numberDigit(num, 0) * DIGITS + numberDigit(num, 1);
+}
+
+/** @brief Podaje korzeń poddrzewa, w którym leżą numery części.
+ * Dla części numerów jednocyfrowych jest to węzeł na głębokości 1, a dla
+ * pozostałych nowy węzeł, który zostanie dołączony na głębokości 2.
+ * @param[in] build – wskaźnik na stan budowania;
+ * @param[in,out] part – wskaźnik na część;
+ * @param[in] key – numer części;
+ * @param[in,out] memory – wskaźnik na opis pamięci wątku.
+ * @return Wskaźnik na węzeł lub NULL, jeśli nie udało się alokować pamięci.
+ */
+static Node *partTop(Build const *build, Part *part, size_t key,
+                     Memory *memory) {
+    if (key >= LONG_PARTS)
+        return build->root->numbers[key - LONG_PARTS];
+    part->top = nodeNew(memory, NULL, key % DIGITS, build->root->width);
+    return part->top;
+}
+
+/** @brief Dopisuje węzeł z przekierowaniem do części.
+ * @param[in] node – wskaźnik na węzeł;
+ * @param[in,out] data – wskaźnik na część.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool partAdd(Node *node, void *data) {
+    Part *part = data;
+    if (part->last == part->size) {
+        size_t size = part->size > 0 ? 2 * part->size : 16;
+        Node **nodes = realloc(part->nodes, size * sizeof(Node *));
+        if (nodes == NULL)
+            return false;
+        part->nodes = nodes;
+        part->size = size;
+    }
+    part->nodes[part->last++] = node;
+    return true;
+}
+
+/** @brief Buduje część drzewa przekierowań.
+ * Dodaje przekierowania części w kolejności wejścia, więc z powtórzonego
+ * numeru zostaje ostatnie, i zbiera węzły z przekierowaniami do dalszego
+ * etapu. Skróty są wyliczane w obrębie części.
+ * @param[in] build – wskaźnik na stan budowania;
+ * @param[in,out] part – wskaźnik na część;
+ * @param[in] key – numer części;
+ * @param[in,out] memory – wskaźnik na opis pamięci wątku.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool buildFrom(Build *build, Part *part, size_t key, Memory *memory) {
+    Node *top = partTop(build, part, key, memory);
+    if (top == NULL)
+        return false;
+    for (size_t i = 0; i < part->count; i++) {
+        char const *num1 = build->num1s[part->indices[i]];
+        char const *num2 = build->num2s[part->indices[i]];
+        Node *node = key < LONG_PARTS ? findOrCreateNode(memory, top, num1 + 2)
+                                      : top;
+        Number *value = node != NULL ? stringNew(memory, num2) : NULL;
+        Number *mine = node != NULL ? stringNew(memory, num1) : NULL;
+        if (value == NULL || mine == NULL) {
+            multiStringFree(memory, 2, value, mine);
+            return false;
+        }
+        uint64_t delta = forwardHash(mine, value) -
+                         (node->value != NULL ? forwardHash(mine, node->value)
+                                              : 0);
+        multiStringFree(memory, 2, node->value, node->mine);
+        node->value = value;
+        node->mine = mine;
+        // Węzeł na głębokości 1 jest współdzielony z innymi częściami, więc
+        // jego przodków poprawiamy dopiero po zakończeniu pracy wątków.
+        if (key < LONG_PARTS)
+            nodeAddHash(node, delta);
+        else
+            top->hash += delta;
+    }
+    if (key < LONG_PARTS)
+        return nodeForEach(top, partAdd, part);
+    return partAdd(top, part);
+}
+
+/** @brief Buduje część drzewa numerów docelowych.
+ * Dla każdego przekierowania części tworzy węzeł numeru docelowego i dodaje
+ * numer przekierowywany do drzewa w jego polu @p backward.
+ * @param[in] build – wskaźnik na stan budowania;
+ * @param[in,out] part – wskaźnik na część;
+ * @param[in] key – numer części;
+ * @param[in,out] memory – wskaźnik na opis pamięci wątku.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool buildTo(Build *build, Part *part, size_t key, Memory *memory) {
+    Node *top = partTop(build, part, key, memory);
+    if (top == NULL)
+        return false;
+    for (size_t i = 0; i < part->last; i++) {
+        Number const *num1 = part->nodes[i]->mine;
+        Number const *num2 = part->nodes[i]->value;
+        Node *to = key < LONG_PARTS
+                   ? findOrCreateNumberNode(memory, top, num2, 2) : top;
+        if (to == NULL)
+            return false;
+        if (to->value == NULL &&
+            (to->value = stringCopy(memory, num2)) == NULL)
+            return false;
+        if (to->backward == NULL &&
+            (to->backward = nodeNew(memory, NULL, 0, to->width)) == NULL)
+            return false;
+        Node *subtree = findOrCreateNumberNode(memory, to->backward, num1, 0);
+        if (subtree == NULL)
+            return false;
+        if (subtree->value == NULL &&
+            (subtree->value = stringCopy(memory, num1)) == NULL)
+            return false;
+    }
+    return true;
+}
+
+/** @brief Buduje kolejne części drzewa.
+ * Funkcja wykonywana przez każdy wątek: pobiera numery części, dopóki są
+ * jakieś do zbudowania. Pamięć przydziela z własnego opisu, który po
+ * zakończeniu wątku przejmuje opis pamięci drzew.
+ * @param[in,out] data – wskaźnik na stan wątku.
+ * @return Wartość NULL.
+ */
+static void *buildParts(void *data) {
+    Build *build = ((Worker *) data)->build;
+    Memory *memory = &((Worker *) data)->memory;
+    for (;;) {
+        size_t key = atomic_fetch_add(&build->next, 1);
+        if (key >= PARTS || atomic_load(&build->failed))
+            break;
+        Part *part = &build->parts[key];
+        if ((part->count > 0 || part->last > 0) &&
+            !build->work(build, part, key, memory))
+            atomic_store(&build->failed, true);
+    }
+    return NULL;
+}
+
+/** @brief Przeprowadza etap budowania.
+ * Tworzy węzły na głębokości 1 potrzebne częściom, buduje części w @p threads
+ * wątkach i dołącza zbudowane poddrzewa do tych węzłów.
+ * @param[in,out] build – wskaźnik na stan budowania;
+ * @param[in,out] memory – wskaźnik na opis pamięci drzew;
+ * @param[in] threads – liczba wątków.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool runPhase(Build *build, Memory *memory, size_t threads) {
+    Node *root = build->root;
+    for (size_t key = 0; key < PARTS; key++) {
+        Part const *part = &build->parts[key];
+        size_t digit = key < LONG_PARTS ? key / DIGITS : key - LONG_PARTS;
+        if ((part->count > 0 || part->last > 0) &&
+            root->numbers[digit] == NULL) {
+            root->numbers[digit] = nodeNew(memory, root, digit, root->width);
+            if (root->numbers[digit] == NULL)
+                return false;
+        }
+    }
+    atomic_init(&build->next, 0);
+    atomic_init(&build->failed, false);
+    if (threads > PARTS)
+        threads = PARTS;
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    Worker *workers = malloc(threads * sizeof(Worker));
+    Worker own = {build, {NULL, NULL, NULL, 0, 0, 0, {NULL, NULL}, NULL, 0}};
+    size_t started = 0;
+    while (ids != NULL && workers != NULL && started + 1 < threads) {
+        workers[started] = own;
+        if (pthread_create(&ids[started], NULL, buildParts,
+                           &workers[started]) != 0)
+            break;
+        started++;
+    }
+    buildParts(&own);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+        memoryMerge(memory, &workers[i].memory);
+    }
+    memoryMerge(memory, &own.memory);
+    multiFree(2, ids, workers);
+    // Dołączamy poddrzewa także po błędzie, aby zostały usunięte razem
+    // z drzewem.
+    for (size_t key = 0; key < LONG_PARTS; key++) {
+        Node *top = build->parts[key].top;
+        if (top != NULL) {
+            Node *parent = root->numbers[key / DIGITS];
+            top->parent = parent;
+            parent->numbers[key % DIGITS] = top;
+            parent->hash += top->hash;
+        }
+    }
+    for (size_t digit = 0; digit < root->width; digit++)
+        if (root->numbers[digit] != NULL)
+            root->hash += root->numbers[digit]->hash;
+    return !atomic_load(&build->failed);
+}
+
+/** @brief Dzieli przekierowania na części drzewa przekierowań.
+ * Zachowuje kolejność przekierowań w każdej części i pomija przekierowania,
+ * które funkcja @ref phfwdAdd by odrzuciła.
+ * @param[in,out] parts – tablica części;
+ * @param[in] width – liczba cyfr alfabetu drzew;
+ * @param[in] num1s – tablica numerów przekierowywanych;
+ * @param[in] num2s – tablica numerów docelowych;
+ * @param[in] count – liczba przekierowań.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool splitPairs(Part *parts, size_t width, char const *const *num1s,
+                       char const *const *num2s, size_t count) {
+    unsigned char *keys = malloc(count + 1);
+    if (keys == NULL)
+        return false;
+    for (size_t i = 0; i < count; i++) {
+        char const *num1 = num1s[i], *num2 = num2s[i];
+        if (!isItNumber(num1) || !isItNumber(num2) || !strcmp(num1, num2) ||
+            (width < DIGITS &&
+             (!fitsAlphabet(num1, width) || !fitsAlphabet(num2, width)))) {
+            keys[i] = SKIPPED;
+        } else {
+            keys[i] = (unsigned char) partOf(num1);
+            parts[keys[i]].count++;
+        }
+    }
+    bool ok = true;
+    for (size_t key = 0; ok && key < PARTS; key++) {
+        if (parts[key].count > 0) {
+            parts[key].indices = malloc(parts[key].count * sizeof(size_t));
+            ok = parts[key].indices != NULL;
+            parts[key].count = 0;
+        }
+    }
+    for (size_t i = 0; ok && i < count; i++)
+        if (keys[i] != SKIPPED)
+            parts[keys[i]].indices[parts[keys[i]].count++] = i;
+    free(keys);
+    return ok;
+}
+
+/** @brief Dzieli przekierowania na części drzewa numerów docelowych.
+ * @param[in,out] to – tablica części drzewa numerów docelowych;
+ * @param[in] from – tablica zbudowanych części drzewa przekierowań.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool splitForwards(Part *to, Part const *from) {
+    for (size_t key = 0; key < PARTS; key++)
+        for (size_t i = 0; i < from[key].last; i++)
+            to[partOfNumber(from[key].nodes[i]->value)].size++;
+    for (size_t key = 0; key < PARTS; key++) {
+        if (to[key].size > 0) {
+            to[key].nodes = malloc(to[key].size * sizeof(Node *));
+            if (to[key].nodes == NULL)
+                return false;
+        }
+    }
+    for (size_t key = 0; key < PARTS; key++) {
+        for (size_t i = 0; i < from[key].last; i++) {
+            Part *part = &to[partOfNumber(from[key].nodes[i]->value)];
+            part->nodes[part->last++] = from[key].nodes[i];
+        }
+    }
+    return true;
+}
+
+bool buildTrees(Memory *memory, Node *from, Node *to,
+                char const *const *num1s, char const *const *num2s,
+                size_t count, size_t threads) {
+    Part *fromParts = calloc(PARTS, sizeof(Part));
+    Part *toParts = calloc(PARTS, sizeof(Part));
+    Build build;
+    build.root = from;
+    build.num1s = num1s;
+    build.num2s = num2s;
+    build.parts = fromParts;
+    build.work = buildFrom;
+    bool ok = fromParts != NULL && toParts != NULL &&
+              splitPairs(fromParts, from->width, num1s, num2s, count) &&
+              runPhase(&build, memory, threads) &&
+              splitForwards(toParts, fromParts);
+    if (ok) {
+        build.root = to;
+        build.parts = toParts;
+        build.work = buildTo;
+        ok = runPhase(&build, memory, threads);
+    }
+    for (size_t key = 0; key < PARTS; key++) {
+        if (fromParts != NULL)
+            multiFree(2, fromParts[key].indices, fromParts[key].nodes);
+        if (toParts != NULL)
+            free(toParts[key].nodes);
+    }
+    multiFree(2, fromParts, toParts);
+    return ok;
+}
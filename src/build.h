@@ -0,0 +1,39 @@
+/** @file
+ * Interfejs równoległego budowania drzew przekierowań numerów telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_NUMBERS_BUILD_H
+#define PHONE_NUMBERS_BUILD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "tree.h"
+
+/** @brief Buduje drzewa przekierowań w wielu wątkach.
+ * Wypełnia puste drzewa @p from i @p to tak, jakby kolejno dodano
+ * przekierowania z @p num1s[i] na @p num2s[i]: przekierowania z niepoprawnych
+ * numerów i na ten sam numer są pomijane, a z powtórzonego numeru wygrywa
+ * ostatnie. Przekierowania są dzielone według dwóch pierwszych cyfr numeru
+ * przekierowywanego, a następnie docelowego, i każda część jest budowana
+ * przez jeden wątek jako osobne poddrzewo, dołączane do korzenia po
+ * zakończeniu pracy wszystkich wątków.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzew, korzystający
+ *                         z funkcji malloc;
+ * @param[in,out] from – wskaźnik na korzeń pustego drzewa przekierowań;
+ * @param[in,out] to – wskaźnik na korzeń pustego drzewa numerów docelowych;
+ * @param[in] num1s – tablica numerów przekierowywanych;
+ * @param[in] num2s – tablica numerów docelowych;
+ * @param[in] count – liczba przekierowań;
+ * @param[in] threads – liczba wątków, co najmniej 1.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci; drzewa trzeba wtedy usunąć.
+ */
+bool buildTrees(Memory *memory, Node *from, Node *to,
+                char const *const *num1s, char const *const *num2s,
+                size_t count, size_t threads);
+
+#endif //PHONE_NUMBERS_BUILD_H
@@ -0,0 +1,92 @@
+/** @file
+ * Implementacja strumienia zmian przekierowań numerów telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include "feed.h"
+
+/**
+ * To jest struktura reprezentująca zmianę zapisaną w strumieniu.
+ */
+typedef struct Change {
+    char *num1; ///< prefiks numerów, których dotyczy zmiana
+    char *num2; ///< prefiks docelowy lub NULL dla usunięcia
+} Change;
+
+/**
+ * To jest implementacja struktury przechowującej strumień zmian.
+ */
+struct Feed {
+    size_t capacity; ///< rozmiar bufora
+    uint64_t first;  ///< numer najstarszej pamiętanej zmiany
+    uint64_t next;   ///< numer następnej zmiany
+    Change changes[]; ///< bufor cykliczny indeksowany numerem modulo rozmiar
+};
+
+Feed *feedNew(size_t capacity) {
+    assert(capacity > 0);
+    Feed *feed = malloc(sizeof(Feed) + capacity * sizeof(Change));
+    if (feed == NULL)
+        return NULL;
+    feed->capacity = capacity;
+    feed->first = 0;
+    feed->next = 0;
+    return feed;
+}
+
+/** @brief Zwalnia najstarszą zmianę.
+ * @param[in,out] feed – wskaźnik na niepusty strumień.
+ */
+static void dropFirst(Feed *feed) {
+    Change *change = &feed->changes[feed->first % feed->capacity];
+    free(change->num1);
+    free(change->num2);
+    feed->first++;
+}
+
+void feedDelete(Feed *feed) {
+    if (feed != NULL) {
+        while (feed->first < feed->next)
+            dropFirst(feed);
+        free(feed);
+    }
+}
+
+void feedPush(Feed *feed, Number const *num1, Number const *num2) {
+    if (feed->next - feed->first == feed->capacity)
+        dropFirst(feed);
+    char *copy1 = numberText(num1);
+    char *copy2 = num2 != NULL ? numberText(num2) : NULL;
+    if (copy1 == NULL || (num2 != NULL && copy2 == NULL)) {
+        free(copy1);
+        free(copy2);
+        while (feed->first < feed->next)
+            dropFirst(feed);
+        feed->next++;
+        feed->first = feed->next;
+        return;
+    }
+    feed->changes[feed->next % feed->capacity] = (Change) {copy1, copy2};
+    feed->next++;
+}
+
+uint64_t feedFirst(Feed const *feed) {
+    return feed->first;
+}
+
+uint64_t feedNext(Feed const *feed) {
+    return feed->next;
+}
+
+void feedGet(Feed const *feed, uint64_t sequence, char const **num1,
+             char const **num2) {
+    assert(sequence >= feed->first && sequence < feed->next);
+    Change const *change = &feed->changes[sequence % feed->capacity];
+    *num1 = change->num1;
+    *num2 = change->num2;
+}
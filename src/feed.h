@@ -0,0 +1,71 @@
+/** @file
+ * Interfejs strumienia zmian przekierowań numerów telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_NUMBERS_FEED_H
+#define PHONE_NUMBERS_FEED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "number.h"
+
+/**
+ * To jest struktura przechowująca ostatnie zmiany przekierowań w buforze
+ * cyklicznym. Każda zmiana ma kolejny numer sekwencyjny.
+ */
+typedef struct Feed Feed;
+
+/** @brief Tworzy strumień zmian.
+ * @param[in] capacity – liczba pamiętanych zmian, co najmniej 1.
+ * @return Wskaźnik na utworzony strumień lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+Feed *feedNew(size_t capacity);
+
+/** @brief Usuwa strumień zmian.
+ * Nic nie robi, jeśli @p feed ma wartość NULL.
+ * @param[in] feed – wskaźnik na usuwany strumień.
+ */
+void feedDelete(Feed *feed);
+
+/** @brief Dopisuje zmianę do strumienia.
+ * Zapamiętuje rozpakowane numery zmiany. Jeśli bufor jest pełny, zastępuje
+ * najstarszą zmianę. Jeśli nie uda się alokować pamięci, porzuca wszystkie
+ * pamiętane zmiany, tak aby czytelnicy nie przeoczyli tej zmiany
+ * niezauważenie.
+ * @param[in,out] feed – wskaźnik na strumień;
+ * @param[in] num1 – spakowany prefiks numerów, których dotyczy zmiana;
+ * @param[in] num2 – spakowany prefiks numerów, na które dodano
+ *                   przekierowanie, lub NULL, jeśli przekierowanie @p num1
+ *                   usunięto.
+ */
+void feedPush(Feed *feed, Number const *num1, Number const *num2);
+
+/** @brief Podaje numer najstarszej pamiętanej zmiany.
+ * @param[in] feed – wskaźnik na strumień.
+ * @return Numer sekwencyjny najstarszej pamiętanej zmiany.
+ */
+uint64_t feedFirst(Feed const *feed);
+
+/** @brief Podaje numer następnej zmiany.
+ * @param[in] feed – wskaźnik na strumień.
+ * @return Numer sekwencyjny, który otrzyma następna zmiana.
+ */
+uint64_t feedNext(Feed const *feed);
+
+/** @brief Udostępnia zmianę.
+ * @param[in] feed – wskaźnik na strumień;
+ * @param[in] sequence – numer sekwencyjny zmiany, od @ref feedFirst
+ *                       włącznie do @ref feedNext wyłącznie;
+ * @param[out] num1 – wskaźnik na prefiks numerów, których dotyczy zmiana;
+ * @param[out] num2 – wskaźnik na prefiks docelowy lub NULL dla usunięcia.
+ */
+void feedGet(Feed const *feed, uint64_t sequence, char const **num1,
+             char const **num2);
+
+#endif //PHONE_NUMBERS_FEED_H
@@ -0,0 +1,473 @@
+/** @file
+ * Implementacja niezmiennej, zwartej reprezentacji przekierowań numerów
+ * telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frozen.h"
+
+/**
+ * To jest struktura reprezentująca węzeł zamrożonego drzewa. Synowie węzła
+ * leżą w tablicy węzłów kolejno, począwszy od indeksu @p child, w kolejności
+ * cyfr, a @p bitmap wskazuje, które cyfry mają syna.
+ */
+typedef struct FrozenNode {
+    uint32_t child;  ///< indeks pierwszego syna
+    uint32_t value;  ///< przekierowanie lub początek listy numerów
+    uint16_t bitmap; ///< mapa bitowa cyfr, które mają syna
+} FrozenNode;
+
+/**
+ * To jest implementacja struktury przechowującej zamrożone drzewa. Za
+ * nagłówkiem leżą kolejno: węzły drzewa przekierowań, węzły drzewa
+ * odwróconych przekierowań, listy numerów przekierowanych na węzły drzewa
+ * odwróconych przekierowań i napisy. W węźle drzewa przekierowań pole
+ * @p value to przesunięcie napisu z przekierowaniem powiększone o 1 lub 0,
+ * jeśli węzeł nie ma przekierowania. W węźle drzewa odwróconych przekierowań
+ * jest to indeks początku listy węzła; lista kończy się tam, gdzie zaczyna
+ * się lista następnego węzła. Każdy numer jest zapisany w napisach raz,
+ * a przekierowania i listy, w których się powtarza, wskazują tę samą kopię.
+ */
+struct Frozen {
+    size_t size;        ///< rozmiar całej struktury w bajtach
+    size_t fromOffset;  ///< przesunięcie węzłów drzewa przekierowań
+    size_t toOffset;    ///< przesunięcie węzłów drzewa odwróconych
+    size_t listOffset;  ///< przesunięcie list numerów
+    size_t poolOffset;  ///< przesunięcie napisów
+    uint32_t depth;     ///< głębokość drzewa przekierowań
+};
+
+/**
+ * To jest struktura przechowująca dane budowanej struktury.
+ */
+typedef struct Builder {
+    FrozenNode *from;   ///< węzły drzewa przekierowań
+    size_t fromCount;   ///< liczba węzłów drzewa przekierowań
+    FrozenNode *to;     ///< węzły drzewa odwróconych przekierowań
+    size_t toCount;     ///< liczba węzłów drzewa odwróconych przekierowań
+    uint32_t *list;     ///< listy numerów
+    size_t listCount;   ///< łączna długość list
+    size_t listSize;    ///< rozmiar tablicy @p list
+    char *pool;         ///< napisy
+    size_t poolSize;    ///< liczba bajtów napisów
+    size_t poolCapacity;///< rozmiar tablicy @p pool
+    uint32_t *table;    ///< tablica mieszająca przesunięć napisów
+    size_t tableSize;   ///< rozmiar tablicy @p table, potęga dwójki lub 0
+    size_t tableCount;  ///< liczba napisów w tablicy @p table
+    uint32_t depth;     ///< głębokość drzewa przekierowań
+} Builder;
+
+/** @brief Zapewnia miejsce w tablicy.
+ * Powiększa tablicę @p array tak, aby zmieściło się w niej @p needed
+ * elementów.
+ * @param[in,out] array – wskaźnik na tablicę;
+ * @param[in,out] size – wskaźnik na rozmiar tablicy w elementach;
+ * @param[in] needed – potrzebna liczba elementów;
+ * @param[in] item – rozmiar elementu.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool reserve(void **array, size_t *size, size_t needed, size_t item) {
+    if (needed <= *size)
+        return true;
+    size_t new_size = *size == 0 ? 1024 : *size;
+    while (new_size < needed)
+        new_size *= 2;
+    void *ptr = realloc(*array, new_size * item);
+    if (ptr == NULL)
+        return false;
+    *array = ptr;
+    *size = new_size;
+    return true;
+}
+
+/** @brief Liczy skrót napisu.
+ * @param[in] str – wskaźnik na napis.
+ * @return Skrót FNV-1a napisu.
+ */
+static uint64_t textHash(char const *str) {
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (; str[0] != '\0'; str++)
+        hash = (hash ^ (unsigned char) str[0]) * UINT64_C(1099511628211);
+    return hash;
+}
+
+/** @brief Wstawia napis do tablicy mieszającej.
+ * Tablica przechowuje przesunięcia napisów powiększone o 1, a 0 oznacza
+ * puste miejsce; kolizje są rozwiązywane adresowaniem liniowym.
+ * @param[in] table – tablica mieszająca;
+ * @param[in] size – rozmiar tablicy, potęga dwójki;
+ * @param[in] pool – napisy budowanej struktury;
+ * @param[in] offset – przesunięcie napisu powiększone o 1.
+ * @return Indeks miejsca z równym napisem lub pustego miejsca, w którym
+ *         zapisano @p offset.
+ */
+static size_t tableInsert(uint32_t *table, size_t size, char const *pool,
+                          uint32_t offset) {
+    char const *str = pool + offset - 1;
+    size_t i = (size_t) textHash(str) & (size - 1);
+    while (table[i] != 0 && strcmp(pool + table[i] - 1, str) != 0)
+        i = (i + 1) & (size - 1);
+    if (table[i] == 0)
+        table[i] = offset;
+    return i;
+}
+
+/** @brief Powiększa tablicę mieszającą.
+ * Zapewnia, że po dodaniu jeszcze jednego napisu tablica będzie zajęta
+ * najwyżej w połowie.
+ * @param[in,out] builder – wskaźnik na dane budowanej struktury.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool tableGrow(Builder *builder) {
+    if (2 * (builder->tableCount + 1) <= builder->tableSize)
+        return true;
+    size_t size = builder->tableSize == 0 ? 1024 : 2 * builder->tableSize;
+    uint32_t *table = calloc(size, sizeof(uint32_t));
+    if (table == NULL)
+        return false;
+    for (size_t i = 0; i < builder->tableSize; i++)
+        if (builder->table[i] != 0)
+            tableInsert(table, size, builder->pool, builder->table[i]);
+    free(builder->table);
+    builder->table = table;
+    builder->tableSize = size;
+    return true;
+}
+
+/** @brief Dodaje numer do budowanej struktury.
+ * Zamrożona struktura przechowuje numery rozpakowane, tak aby zapytania
+ * zwracały wskaźniki na gotowe napisy. Numer, który już jest w napisach,
+ * nie jest dopisywany ponownie.
+ * @param[in,out] builder – wskaźnik na dane budowanej struktury;
+ * @param[in] num – wskaźnik na dodawany spakowany numer.
+ * @return Przesunięcie napisu z numerem powiększone o 1 lub 0, jeśli nie
+ *         udało się alokować pamięci lub napisy są za duże.
+ */
+static uint32_t addNumber(Builder *builder, Number const *num) {
+    size_t length = numberLength(num) + 1;
+    if (builder->poolSize + length >= UINT32_MAX ||
+        !reserve((void **) &builder->pool, &builder->poolCapacity,
+                 builder->poolSize + length, sizeof(char)) ||
+        !tableGrow(builder))
+        return 0;
+    numberDecode(num, builder->pool + builder->poolSize);
+    uint32_t offset = (uint32_t) builder->poolSize + 1;
+    size_t i = tableInsert(builder->table, builder->tableSize, builder->pool,
+                           offset);
+    if (builder->table[i] != offset)
+        return builder->table[i];
+    builder->tableCount++;
+    builder->poolSize += length;
+    return offset;
+}
+
+/** @brief Dopisuje numer do listy.
+ * Dopisuje numer przechowywany w węźle @p node drzewa numerów
+ * przekierowanych do listy numerów budowanej struktury.
+ * @param[in] node – wskaźnik na węzeł z numerem;
+ * @param[in,out] data – wskaźnik na dane budowanej struktury.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool addMine(Node *node, void *data) {
+    Builder *builder = data;
+    uint32_t offset = addNumber(builder, node->value);
+    if (offset == 0 || builder->listCount >= UINT32_MAX ||
+        !reserve((void **) &builder->list, &builder->listSize,
+                 builder->listCount + 1, sizeof(uint32_t)))
+        return false;
+    builder->list[builder->listCount++] = offset - 1;
+    return true;
+}
+
+/** @brief Zamraża drzewo.
+ * Układa węzły drzewa @p root wszerz, tak że synowie każdego węzła leżą
+ * obok siebie. Dla drzewa przekierowań zapisuje przekierowania węzłów, a dla
+ * drzewa odwróconych przekierowań – listy numerów z ich pól @p backward.
+ * @param[in] root – wskaźnik na korzeń drzewa;
+ * @param[in] reverse – czy to drzewo odwróconych przekierowań;
+ * @param[in,out] builder – wskaźnik na dane budowanej struktury;
+ * @param[out] nodes – wskaźnik na tablicę zamrożonych węzłów;
+ * @param[out] count – wskaźnik na liczbę zamrożonych węzłów.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci lub drzewo jest za duże.
+ */
+static bool freezeTree(Node *root, bool reverse, Builder *builder,
+                       FrozenNode **nodes, size_t *count) {
+    Node **queue = NULL;
+    size_t queueSize = 0, tail = 0, nodesSize = 0, levelEnd = 1;
+    bool ok = reserve((void **) &queue, &queueSize, 1, sizeof(Node *));
+    if (ok)
+        queue[tail++] = root;
+    uint32_t depth = 0;
+    for (size_t head = 0; ok && head < tail; head++) {
+        if (head == levelEnd) {
+            depth++;
+            levelEnd = tail;
+        }
+        Node *node = queue[head];
+        ok = tail + node->width < UINT32_MAX &&
+             reserve((void **) nodes, &nodesSize, head + 2,
+                     sizeof(FrozenNode)) &&
+             reserve((void **) &queue, &queueSize, tail + node->width,
+                     sizeof(Node *));
+        if (!ok)
+            break;
+        FrozenNode *frozen = &(*nodes)[head];
+        frozen->child = (uint32_t) tail;
+        frozen->bitmap = 0;
+        for (size_t i = 0; i < node->width; i++) {
+            if (node->numbers[i] != NULL) {
+                frozen->bitmap |= (uint16_t) (1u << i);
+                queue[tail++] = node->numbers[i];
+            }
+        }
+        if (reverse) {
+            frozen->value = (uint32_t) builder->listCount;
+            if (head > 0)
+                ok = nodeForEach(node->backward, addMine, builder);
+        } else {
+            frozen->value = node->value == NULL
+                            ? 0 : addNumber(builder, node->value);
+            ok = node->value == NULL || frozen->value != 0;
+        }
+    }
+    if (ok && reverse) {
+        // Węzeł wartownik wyznacza koniec listy ostatniego węzła.
+        (*nodes)[tail] = (FrozenNode) {0, (uint32_t) builder->listCount, 0};
+    }
+    if (!reverse)
+        builder->depth = depth;
+    *count = tail;
+    free(queue);
+    return ok;
+}
+
+/** @brief Wyrównuje przesunięcie.
+ * @param[in] offset – przesunięcie.
+ * @return Najmniejsza wielokrotność 8 nie mniejsza niż @p offset.
+ */
+static inline size_t align(size_t offset) {
+    return (offset + 7) / 8 * 8;
+}
+
+Frozen *frozenNew(Node *from, Node *to) {
+    assert(from != NULL && to != NULL);
+    Builder builder;
+    memset(&builder, 0, sizeof builder);
+    Frozen *frozen = NULL;
+    if (freezeTree(from, false, &builder, &builder.from, &builder.fromCount) &&
+        freezeTree(to, true, &builder, &builder.to, &builder.toCount)) {
+        size_t fromOffset = align(sizeof(Frozen));
+        size_t toOffset = align(fromOffset +
+                                builder.fromCount * sizeof(FrozenNode));
+        size_t listOffset = align(toOffset +
+                                  (builder.toCount + 1) * sizeof(FrozenNode));
+        size_t poolOffset = align(listOffset +
+                                  builder.listCount * sizeof(uint32_t));
+        size_t size = poolOffset + builder.poolSize;
+        frozen = malloc(size);
+        if (frozen != NULL) {
+            *frozen = (Frozen) {size, fromOffset, toOffset, listOffset,
+                                poolOffset, builder.depth};
+            char *base = (char *) frozen;
+            memcpy(base + fromOffset, builder.from,
+                   builder.fromCount * sizeof(FrozenNode));
+            memcpy(base + toOffset, builder.to,
+                   (builder.toCount + 1) * sizeof(FrozenNode));
+            if (builder.listCount > 0)
+                memcpy(base + listOffset, builder.list,
+                       builder.listCount * sizeof(uint32_t));
+            if (builder.poolSize > 0)
+                memcpy(base + poolOffset, builder.pool, builder.poolSize);
+        }
+    }
+    free(builder.from);
+    free(builder.to);
+    free(builder.list);
+    free(builder.pool);
+    free(builder.table);
+    return frozen;
+}
+
+void frozenDelete(Frozen *frozen) {
+    free(frozen);
+}
+
+size_t frozenSize(Frozen const *frozen) {
+    return frozen->size;
+}
+
+/** @brief Podaje tablicę węzłów.
+ * @param[in] frozen – wskaźnik na strukturę;
+ * @param[in] offset – przesunięcie tablicy węzłów.
+ * @return Wskaźnik na tablicę węzłów.
+ */
+static inline FrozenNode const *nodesAt(Frozen const *frozen, size_t offset) {
+    return (FrozenNode const *) ((char const *) frozen + offset);
+}
+
+/** @brief Podaje napisy.
+ * @param[in] frozen – wskaźnik na strukturę.
+ * @return Wskaźnik na początek napisów.
+ */
+static inline char const *pool(Frozen const *frozen) {
+    return (char const *) frozen + frozen->poolOffset;
+}
+
+/** @brief Przechodzi do syna węzła.
+ * @param[in] nodes – tablica węzłów;
+ * @param[in] node – indeks węzła;
+ * @param[in] num – cyfra syna zapisana jako char.
+ * @return Indeks syna lub -1, jeśli węzeł nie ma takiego syna.
+ */
+static inline int64_t child(FrozenNode const *nodes, uint32_t node, char num) {
+    unsigned bit = 1u << digitFinder(num);
+    if ((nodes[node].bitmap & bit) == 0)
+        return -1;
+    unsigned before = nodes[node].bitmap & (bit - 1);
+#ifdef __GNUC__
+    unsigned rank = (unsigned) __builtin_popcount(before);
+#else
+    unsigned rank = 0;
+    for (; before != 0; before &= before - 1)
+        rank++;
+#endif
+    return nodes[node].child + rank;
+}
+
+char const *frozenFindLongest(Frozen const *frozen, char const **num) {
+    FrozenNode const *nodes = nodesAt(frozen, frozen->fromOffset);
+    char const *value = NULL;
+    char const *suffix = *num;
+    char const *position = *num;
+    uint32_t node = 0;
+    for (;;) {
+        if (nodes[node].value != 0) {
+            value = pool(frozen) + nodes[node].value - 1;
+            suffix = position;
+        }
+        if (position[0] == '\0')
+            break;
+        int64_t next = child(nodes, node, position[0]);
+        if (next < 0)
+            break;
+        node = (uint32_t) next;
+        position++;
+    }
+    *num = suffix;
+    return value;
+}
+
+char const *frozenFindLongestNumber(Frozen const *frozen, Number const *num,
+                                    size_t *depth) {
+    FrozenNode const *nodes = nodesAt(frozen, frozen->fromOffset);
+    char const *value = NULL;
+    size_t length = numberLength(num);
+    uint32_t node = 0;
+    *depth = 0;
+    for (size_t i = 0;; i++) {
+        if (nodes[node].value != 0) {
+            value = pool(frozen) + nodes[node].value - 1;
+            *depth = i;
+        }
+        if (i == length)
+            break;
+        int64_t next = child(nodes, node, digitChar(numberDigit(num, i)));
+        if (next < 0)
+            break;
+        node = (uint32_t) next;
+    }
+    return value;
+}
+
+bool frozenForEachReverse(Frozen const *frozen, char const *num,
+                          bool (*visit)(char const *mine, char const *suffix,
+                                        void *data),
+                          void *data) {
+    FrozenNode const *nodes = nodesAt(frozen, frozen->toOffset);
+    uint32_t const *list = (uint32_t const *) ((char const *) frozen +
+                                               frozen->listOffset);
+    uint32_t node = 0;
+    while (num[0] != '\0') {
+        int64_t next = child(nodes, node, num[0]);
+        if (next < 0)
+            break;
+        node = (uint32_t) next;
+        num++;
+        for (uint32_t i = nodes[node].value; i < nodes[node + 1].value; i++)
+            if (!visit(pool(frozen) + list[i], num, data))
+                return false;
+    }
+    return true;
+}
+
+size_t frozenReverseLists(Frozen const *frozen, char const *num,
+                          FrozenList *lists) {
+    FrozenNode const *nodes = nodesAt(frozen, frozen->toOffset);
+    uint32_t const *list = (uint32_t const *) ((char const *) frozen +
+                                               frozen->listOffset);
+    uint32_t node = 0;
+    size_t count = 0;
+    for (; num[count] != '\0'; count++) {
+        int64_t next = child(nodes, node, num[count]);
+        if (next < 0)
+            break;
+        node = (uint32_t) next;
+        lists[count] = (FrozenList) {pool(frozen), list + nodes[node].value,
+                                     nodes[node + 1].value - nodes[node].value};
+    }
+    return count;
+}
+
+bool frozenForEachForward(Frozen const *frozen,
+                          bool (*visit)(char const *num1, char const *num2,
+                                        void *data),
+                          void *data) {
+    FrozenNode const *nodes = nodesAt(frozen, frozen->fromOffset);
+    size_t depth = frozen->depth;
+    uint32_t *stack = malloc((depth + 1) * sizeof(uint32_t));
+    unsigned char *next = malloc(depth + 1);
+    char *path = malloc(depth + 1);
+    bool ok = stack != NULL && next != NULL && path != NULL;
+    size_t level = 0;
+    if (ok) {
+        stack[0] = 0;
+        next[0] = 0;
+    }
+    while (ok) {
+        FrozenNode const *node = &nodes[stack[level]];
+        unsigned digit = next[level];
+        while (digit < DIGITS && (node->bitmap & (1u << digit)) == 0)
+            digit++;
+        if (digit == DIGITS) {
+            if (level == 0)
+                break;
+            level--;
+            continue;
+        }
+        next[level] = (unsigned char) (digit + 1);
+        path[level] = digitChar(digit);
+        stack[level + 1] = (uint32_t) child(nodes, stack[level], path[level]);
+        level++;
+        next[level] = 0;
+        if (nodes[stack[level]].value != 0) {
+            path[level] = '\0';
+            ok = visit(path, pool(frozen) + nodes[stack[level]].value - 1,
+                       data);
+        }
+    }
+    free(stack);
+    free(next);
+    free(path);
+    return ok;
+}
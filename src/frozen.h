@@ -0,0 +1,129 @@
+/** @file
+ * Interfejs niezmiennej, zwartej reprezentacji przekierowań numerów
+ * telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_NUMBERS_FROZEN_H
+#define PHONE_NUMBERS_FROZEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "tree.h"
+
+/**
+ * To jest struktura przechowująca zamrożone drzewa przekierowań. Zajmuje
+ * jeden ciągły blok pamięci i nie zawiera wskaźników, więc można ją
+ * kopiować funkcją memcpy.
+ */
+typedef struct Frozen Frozen;
+
+/**
+ * To jest struktura opisująca listę numerów przekierowanych na jeden prefiks
+ * numeru. Numery listy są posortowane leksykograficznie, tak jak wyniki
+ * zapytań odwrotnych.
+ */
+typedef struct FrozenList {
+    char const *pool;        ///< napisy zamrożonej struktury
+    uint32_t const *offsets; ///< przesunięcia kolejnych numerów w @p pool
+    size_t count;            ///< liczba numerów listy
+} FrozenList;
+
+/** @brief Zamraża drzewa przekierowań.
+ * Tworzy zwartą kopię drzewa przekierowań @p from i drzewa odwróconych
+ * przekierowań @p to. Każdy węzeł zajmuje kilkanaście bajtów: zamiast
+ * tablicy wskaźników na synów ma mapę bitową istniejących synów i indeks
+ * pierwszego z nich, bo synowie każdego węzła leżą obok siebie. Każdy
+ * numer jest zapisany raz, niezależnie od liczby miejsc, w których występuje.
+ * @param[in] from – wskaźnik na korzeń drzewa przekierowań;
+ * @param[in] to – wskaźnik na korzeń drzewa odwróconych przekierowań.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci lub drzewa są za duże.
+ */
+Frozen *frozenNew(Node *from, Node *to);
+
+/** @brief Usuwa zamrożone drzewa.
+ * Nic nie robi, jeśli @p frozen ma wartość NULL.
+ * @param[in] frozen – wskaźnik na usuwaną strukturę.
+ */
+void frozenDelete(Frozen *frozen);
+
+/** @brief Podaje rozmiar zamrożonych drzew.
+ * @param[in] frozen – wskaźnik na strukturę.
+ * @return Liczba bajtów zajmowanych przez strukturę.
+ */
+size_t frozenSize(Frozen const *frozen);
+
+/** @brief Szuka najdłuższego prefiksu numeru, który ma przekierowanie.
+ * Odpowiednik funkcji @ref findLongest dla zamrożonych drzew.
+ * @param[in] frozen – wskaźnik na strukturę;
+ * @param[in, out] num – wskaźnik na numer; po wyjściu wskazuje sufiks
+ *                       numeru, który pozostaje po znalezionym prefiksie.
+ * @return Przekierowanie znalezionego prefiksu lub NULL, jeśli żaden prefiks
+ *         numeru nie jest przekierowany.
+ */
+char const *frozenFindLongest(Frozen const *frozen, char const **num);
+
+/** @brief Szuka najdłuższego prefiksu spakowanego numeru, który ma
+ * przekierowanie.
+ * Odpowiednik funkcji @ref frozenFindLongest dla spakowanego numeru.
+ * @param[in] frozen – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[out] depth – długość znalezionego prefiksu lub 0, jeśli żaden
+ *                     prefiks nie jest przekierowany.
+ * @return Przekierowanie znalezionego prefiksu lub NULL, jeśli żaden prefiks
+ *         numeru nie jest przekierowany.
+ */
+char const *frozenFindLongestNumber(Frozen const *frozen, Number const *num,
+                                    size_t *depth);
+
+/** @brief Przegląda przekierowania na prefiksy numeru.
+ * Dla każdego niepustego prefiksu numeru @p num, kolejno od najkrótszego,
+ * i dla każdego numeru przekierowanego na ten prefiks, w porządku
+ * leksykograficznym, wywołuje @p visit z tym numerem i sufiksem @p num
+ * pozostającym po prefiksie.
+ * @param[in] frozen – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na poprawny numer;
+ * @param[in] visit – funkcja wywoływana dla znalezionych numerów;
+ * @param[in] data – wskaźnik przekazywany do funkcji @p visit.
+ * @return Wartość @p true, jeśli przejrzano wszystkie numery, lub @p false,
+ *         jeśli @p visit przerwała przeglądanie.
+ */
+bool frozenForEachReverse(Frozen const *frozen, char const *num,
+                          bool (*visit)(char const *mine, char const *suffix,
+                                        void *data),
+                          void *data);
+
+/** @brief Podaje listy numerów przekierowanych na prefiksy numeru.
+ * Dla kolejnych niepustych prefiksów numeru @p num, od najkrótszego,
+ * zapisuje w @p lists listę numerów przekierowanych na ten prefiks, dopóki
+ * prefiks występuje w drzewie odwróconych przekierowań.
+ * @param[in] frozen – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na poprawny numer;
+ * @param[out] lists – tablica co najmniej tylu list, ile cyfr ma @p num.
+ * @return Liczba zapisanych list; lista o indeksie i dotyczy prefiksu
+ *         długości i + 1.
+ */
+size_t frozenReverseLists(Frozen const *frozen, char const *num,
+                          FrozenList *lists);
+
+/** @brief Przegląda wszystkie przekierowania.
+ * Wywołuje @p visit dla każdego przekierowania, w porządku leksykograficznym
+ * numerów przekierowywanych.
+ * @param[in] frozen – wskaźnik na strukturę;
+ * @param[in] visit – funkcja wywoływana dla przekierowań;
+ * @param[in] data – wskaźnik przekazywany do funkcji @p visit.
+ * @return Wartość @p true, jeśli przejrzano wszystkie przekierowania, lub
+ *         @p false, jeśli @p visit przerwała przeglądanie lub nie udało się
+ *         alokować pamięci.
+ */
+bool frozenForEachForward(Frozen const *frozen,
+                          bool (*visit)(char const *num1, char const *num2,
+                                        void *data),
+                          void *data);
+
+#endif //PHONE_NUMBERS_FROZEN_H
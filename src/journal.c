@@ -0,0 +1,218 @@
+/** @file
+ * Implementacja dziennika operacji wykonywanych na przekierowaniach numerów
+ * telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "journal.h"
+
+/**
+ * Rozmiar bufora pliku dziennika.
+ */
+#define JOURNAL_BUFFER (64 * 1024)
+
+/**
+ * To jest implementacja struktury reprezentującej otwarty dziennik.
+ */
+struct Journal {
+    FILE *file;     ///< plik dziennika otwarty do dopisywania
+    char *path;     ///< ścieżka do pliku dziennika
+    size_t batch;   ///< liczba operacji utrwalanych jednym wywołaniem fsync
+    size_t pending; ///< liczba operacji oczekujących na utrwalenie
+};
+
+/** @brief Otwiera plik dziennika.
+ * Otwiera plik @p path do dopisywania i ustawia mu duży bufor.
+ * @param[in] path – ścieżka do pliku dziennika.
+ * @return Wskaźnik na otwarty plik lub NULL w przypadku błędu.
+ */
+static FILE *openAppend(char const *path) {
+    FILE *file = fopen(path, "a");
+    if (file != NULL)
+        setvbuf(file, NULL, _IOFBF, JOURNAL_BUFFER);
+    return file;
+}
+
+Journal *journalOpen(char const *path, size_t batch) {
+    assert(path != NULL);
+    Journal *new = malloc(1 * sizeof(Journal));
+    if (new == NULL)
+        return NULL;
+    new->path = malloc(strlen(path) + 1);
+    if (new->path == NULL) {
+        free(new);
+        return NULL;
+    }
+    strcpy(new->path, path);
+    new->file = openAppend(path);
+    if (new->file == NULL) {
+        free(new->path);
+        free(new);
+        return NULL;
+    }
+    new->batch = batch == 0 ? 1 : batch;
+    new->pending = 0;
+    return new;
+}
+
+bool journalSync(Journal *journal) {
+    assert(journal != NULL);
+    if (fflush(journal->file) != 0 || fdatasync(fileno(journal->file)) != 0)
+        return false;
+    journal->pending = 0;
+    return true;
+}
+
+bool journalClose(Journal *journal) {
+    if (journal == NULL)
+        return true;
+    bool result = journalSync(journal);
+    if (fclose(journal->file) != 0)
+        result = false;
+    free(journal->path);
+    free(journal);
+    return result;
+}
+
+/** @brief Kończy zapis operacji.
+ * Zlicza zapisaną operację i utrwala dziennik, jeśli uzbierała się pełna
+ * grupa operacji.
+ * @param[in,out] journal – wskaźnik na dziennik;
+ * @param[in] written – wynik zapisu operacji do pliku.
+ * @return Wartość @p true, jeśli operacja się powiodła.
+ */
+static bool commit(Journal *journal, int written) {
+    if (written < 0)
+        return false;
+    journal->pending++;
+    if (journal->pending >= journal->batch)
+        return journalSync(journal);
+    return true;
+}
+
+bool journalAdd(Journal *journal, char const *num1, char const *num2) {
+    assert(journal != NULL);
+    return commit(journal, fprintf(journal->file, "+ %s %s\n", num1, num2));
+}
+
+bool journalRemove(Journal *journal, char const *num) {
+    assert(journal != NULL);
+    return commit(journal, fprintf(journal->file, "- %s\n", num));
+}
+
+long journalOffset(Journal *journal) {
+    assert(journal != NULL);
+    if (!journalSync(journal) || fseek(journal->file, 0, SEEK_END) != 0)
+        return -1;
+    return ftell(journal->file);
+}
+
+bool journalSyncDirectory(char const *path) {
+    assert(path != NULL);
+    char const *slash = strrchr(path, '/');
+    size_t length = slash == NULL ? 0 : slash == path ? 1
+                                                      : (size_t) (slash - path);
+    char *directory = malloc(length + 2);
+    if (directory == NULL)
+        return false;
+    if (length == 0)
+        strcpy(directory, ".");
+    else {
+        memcpy(directory, path, length);
+        directory[length] = '\0';
+    }
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    free(directory);
+    if (fd < 0)
+        return false;
+    bool result = fsync(fd) == 0;
+    if (close(fd) != 0)
+        result = false;
+    return result;
+}
+
+bool journalTruncate(Journal *journal, long offset) {
+    assert(journal != NULL);
+    if (!journalSync(journal))
+        return false;
+    char *tmp = malloc(strlen(journal->path) + 5);
+    if (tmp == NULL)
+        return false;
+    strcpy(tmp, journal->path);
+    strcat(tmp, ".tmp");
+    // Nowy plik otwieramy do dopisywania jeszcze przed podmianą, aby po
+    // udanej podmianie nie mogło zabraknąć uchwytu do niego.
+    remove(tmp);
+    FILE *in = fopen(journal->path, "r");
+    FILE *out = openAppend(tmp);
+    bool ok = in != NULL && out != NULL && fseek(in, offset, SEEK_SET) == 0;
+    char buffer[JOURNAL_BUFFER];
+    size_t read;
+    while (ok && (read = fread(buffer, 1, sizeof buffer, in)) > 0)
+        ok = fwrite(buffer, 1, read, out) == read;
+    if (in != NULL) {
+        if (ferror(in))
+            ok = false;
+        fclose(in);
+    }
+    ok = ok && fflush(out) == 0 && fsync(fileno(out)) == 0 &&
+         rename(tmp, journal->path) == 0;
+    if (!ok) {
+        if (out != NULL)
+            fclose(out);
+        remove(tmp);
+        free(tmp);
+        return false;
+    }
+    free(tmp);
+    fclose(journal->file);
+    journal->file = out;
+    return journalSyncDirectory(journal->path);
+}
+
+bool journalReplay(char const *path,
+                   bool (*add)(void *data, char const *num1, char const *num2),
+                   void (*erase)(void *data, char const *num), void *data,
+                   long *end) {
+    assert(path != NULL && end != NULL);
+    *end = -1;
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return true;
+    *end = 0;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    bool result = true;
+    while (result && (length = getline(&line, &size, file)) > 0) {
+        if (line[length - 1] != '\n')
+            break;
+        *end += length;
+        line[length - 1] = '\0';
+        if (line[0] == '+' && line[1] == ' ') {
+            char *num2 = strchr(line + 2, ' ');
+            if (num2 == NULL)
+                continue;
+            num2[0] = '\0';
+            result = add(data, line + 2, num2 + 1);
+        } else if (line[0] == '-' && line[1] == ' ') {
+            erase(data, line + 2);
+        }
+    }
+    if (ferror(file))
+        result = false;
+    free(line);
+    fclose(file);
+    return result;
+}
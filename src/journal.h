@@ -0,0 +1,108 @@
+/** @file
+ * Interfejs dziennika operacji wykonywanych na przekierowaniach numerów
+ * telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_NUMBERS_JOURNAL_H
+#define PHONE_NUMBERS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * To jest struktura reprezentująca otwarty dziennik operacji.
+ */
+typedef struct Journal Journal;
+
+/** @brief Otwiera dziennik.
+ * Otwiera do dopisywania plik dziennika @p path, tworząc go w razie potrzeby.
+ * Zapisy są utrwalane na dysku (fsync) grupami po @p batch operacji.
+ * @param[in] path – ścieżka do pliku dziennika;
+ * @param[in] batch – liczba operacji utrwalanych jednym wywołaniem fsync,
+ *                    wartość 0 oznacza 1.
+ * @return Wskaźnik na strukturę dziennika lub NULL, gdy nie udało się
+ *         otworzyć pliku lub alokować pamięci.
+ */
+Journal *journalOpen(char const *path, size_t batch);
+
+/** @brief Zamyka dziennik.
+ * Utrwala niezapisane operacje i zamyka dziennik. Nic nie robi, jeśli
+ * @p journal ma wartość NULL.
+ * @param[in] journal – wskaźnik na zamykany dziennik.
+ * @return Wartość @p true, jeśli wszystkie operacje zostały utrwalone.
+ */
+bool journalClose(Journal *journal);
+
+/** @brief Zapisuje w dzienniku dodanie przekierowania.
+ * @param[in,out] journal – wskaźnik na dziennik;
+ * @param[in] num1 – prefiks numerów przekierowywanych;
+ * @param[in] num2 – prefiks numerów, na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli zapis się powiódł.
+ */
+bool journalAdd(Journal *journal, char const *num1, char const *num2);
+
+/** @brief Zapisuje w dzienniku usunięcie przekierowań.
+ * @param[in,out] journal – wskaźnik na dziennik;
+ * @param[in] num – prefiks numerów, których przekierowania usunięto.
+ * @return Wartość @p true, jeśli zapis się powiódł.
+ */
+bool journalRemove(Journal *journal, char const *num);
+
+/** @brief Utrwala dziennik.
+ * Zapisuje na dysk wszystkie operacje oczekujące na utrwalenie.
+ * @param[in,out] journal – wskaźnik na dziennik.
+ * @return Wartość @p true, jeśli operacja się powiodła.
+ */
+bool journalSync(Journal *journal);
+
+/** @brief Podaje pozycję końca dziennika.
+ * Utrwala dziennik i zwraca liczbę bajtów zapisanych w pliku.
+ * @param[in,out] journal – wskaźnik na dziennik.
+ * @return Pozycja końca dziennika lub -1 w przypadku błędu.
+ */
+long journalOffset(Journal *journal);
+
+/** @brief Skraca dziennik.
+ * Usuwa z początku dziennika operacje zapisane przed pozycją @p offset,
+ * zastępując plik nowym, zawierającym tylko pozostałe operacje. Nowy plik
+ * jest otwierany przed podmianą, więc dalsze operacje zawsze trafiają do
+ * pliku widocznego pod ścieżką dziennika.
+ * @param[in,out] journal – wskaźnik na dziennik;
+ * @param[in] offset – pozycja uzyskana wcześniej z @ref journalOffset.
+ * @return Wartość @p true, jeśli operacja się powiodła i podmiana została
+ *         utrwalona. Jeśli nie udało się podmienić pliku, dziennik pozostaje
+ *         niezmieniony.
+ */
+bool journalTruncate(Journal *journal, long offset);
+
+/** @brief Utrwala wpis pliku w katalogu.
+ * Wywołuje fsync dla katalogu zawierającego plik @p path, tak aby utworzenie
+ * lub przemianowanie pliku przetrwało awarię.
+ * @param[in] path – ścieżka do pliku.
+ * @return Wartość @p true, jeśli operacja się powiodła.
+ */
+bool journalSyncDirectory(char const *path);
+
+/** @brief Odtwarza operacje zapisane w dzienniku.
+ * Wywołuje kolejno @p add i @p erase dla operacji zapisanych w pliku
+ * @p path. Niekompletny ostatni zapis (np. przerwany awarią) jest pomijany,
+ * a pod @p end jest zapisywana pozycja końca ostatniego kompletnego zapisu,
+ * do której należy skrócić plik przed dopisywaniem kolejnych operacji.
+ * Brak pliku nie jest błędem, pozycją jest wtedy -1.
+ * @param[in] path – ścieżka do pliku dziennika;
+ * @param[in] add – funkcja wywoływana dla dodanych przekierowań;
+ * @param[in] erase – funkcja wywoływana dla usuniętych przekierowań;
+ * @param[in] data – wskaźnik przekazywany do funkcji @p add i @p erase;
+ * @param[out] end – wskaźnik na pozycję końca kompletnych zapisów.
+ * @return Wartość @p true, jeśli odtworzono wszystkie kompletne operacje.
+ */
+bool journalReplay(char const *path,
+                   bool (*add)(void *data, char const *num1, char const *num2),
+                   void (*erase)(void *data, char const *num), void *data,
+                   long *end);
+
+#endif //PHONE_NUMBERS_JOURNAL_H
@@ -0,0 +1,123 @@
+/** @file
+ * Implementacja tablicy skoków do górnych poziomów drzewa przekierowań.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include "jump.h"
+
+/**
+ * To jest struktura reprezentująca pozycję tablicy skoków.
+ */
+typedef struct Jump {
+    Node *node;                 ///< najgłębszy węzeł na ścieżce
+    Node *longest;              ///< najgłębszy węzeł z przekierowaniem lub NULL
+    unsigned char depth;        ///< głębokość węzła @p node
+    unsigned char longestDepth; ///< głębokość węzła @p longest
+} Jump;
+
+/**
+ * To jest implementacja struktury przechowującej tablicę skoków.
+ */
+struct JumpTable {
+    Node *root;     ///< korzeń drzewa przekierowań
+    size_t levels;  ///< liczba poziomów obejmowanych przez tablicę
+    size_t width;   ///< liczba cyfr alfabetu drzewa
+    Jump jumps[];   ///< pozycje tablicy indeksowane ciągami cyfr
+};
+
+/** @brief Wylicza pozycję tablicy skoków.
+ * Przechodzi od korzenia ścieżką ciągu cyfr odpowiadającego pozycji
+ * @p index.
+ * @param[in,out] table – wskaźnik na tablicę;
+ * @param[in] index – indeks pozycji.
+ */
+static void jumpFill(JumpTable *table, size_t index) {
+    size_t digits[JUMP_MAX_LEVELS];
+    size_t rest = index;
+    for (size_t i = table->levels; i > 0; i--) {
+        digits[i - 1] = rest % table->width;
+        rest /= table->width;
+    }
+    Jump jump = {table->root, NULL, 0, 0};
+    for (;;) {
+        if (jump.node->value != NULL) {
+            jump.longest = jump.node;
+            jump.longestDepth = jump.depth;
+        }
+        if (jump.depth == table->levels ||
+            jump.node->numbers[digits[jump.depth]] == NULL)
+            break;
+        jump.node = jump.node->numbers[digits[jump.depth]];
+        jump.depth++;
+    }
+    table->jumps[index] = jump;
+}
+
+JumpTable *jumpNew(Node *root, size_t levels) {
+    assert(root != NULL && levels > 0 && levels <= JUMP_MAX_LEVELS);
+    size_t count = 1;
+    for (size_t i = 0; i < levels; i++)
+        count *= root->width;
+    JumpTable *table = malloc(sizeof(JumpTable) + count * sizeof(Jump));
+    if (table == NULL)
+        return NULL;
+    table->root = root;
+    table->levels = levels;
+    table->width = root->width;
+    for (size_t i = 0; i < count; i++)
+        jumpFill(table, i);
+    return table;
+}
+
+void jumpDelete(JumpTable *table) {
+    free(table);
+}
+
+size_t jumpLevels(JumpTable const *table) {
+    return table->levels;
+}
+
+void jumpUpdate(JumpTable *table, char const *prefix, size_t length) {
+    assert(length <= table->levels);
+    size_t first = 0;
+    for (size_t i = 0; i < length; i++) {
+        size_t digit = digitFinder(prefix[i]);
+        if (digit >= table->width)
+            return;
+        first = first * table->width + digit;
+    }
+    size_t count = 1;
+    for (size_t i = length; i < table->levels; i++)
+        count *= table->width;
+    first *= count;
+    for (size_t i = 0; i < count; i++)
+        jumpFill(table, first + i);
+}
+
+Node *jumpFindLongest(JumpTable const *table, char const **num) {
+    size_t index = 0;
+    for (size_t i = 0; i < table->levels; i++) {
+        size_t digit = (*num)[i] == '\0' ? table->width
+                                         : digitFinder((*num)[i]);
+        if (digit >= table->width)
+            return findLongest(table->root, num);
+        index = index * table->width + digit;
+    }
+    Jump const *jump = &table->jumps[index];
+    char const *rest = *num + jump->depth;
+    Node *found = findLongest(jump->node, &rest);
+    if (found->value != NULL) {
+        *num = rest;
+        return found;
+    }
+    if (jump->longest != NULL) {
+        *num += jump->longestDepth;
+        return jump->longest;
+    }
+    return table->root;
+}
@@ -0,0 +1,72 @@
+/** @file
+ * Interfejs tablicy skoków do górnych poziomów drzewa przekierowań.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_NUMBERS_JUMP_H
+#define PHONE_NUMBERS_JUMP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "tree.h"
+
+/**
+ * Maksymalna liczba poziomów obejmowanych przez tablicę skoków.
+ */
+#define JUMP_MAX_LEVELS 5
+
+/**
+ * To jest struktura przechowująca tablicę skoków. Tablica ma po jednej
+ * pozycji dla każdego ciągu pierwszych cyfr numeru i pamięta najgłębszy
+ * węzeł drzewa na ścieżce tego ciągu oraz najgłębsze przekierowanie po
+ * drodze.
+ */
+typedef struct JumpTable JumpTable;
+
+/** @brief Tworzy tablicę skoków.
+ * Tworzy tablicę skoków dla pierwszych @p levels poziomów drzewa @p root.
+ * @param[in] root – wskaźnik na korzeń drzewa przekierowań;
+ * @param[in] levels – liczba poziomów, od 1 do @ref JUMP_MAX_LEVELS.
+ * @return Wskaźnik na utworzoną tablicę lub NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+JumpTable *jumpNew(Node *root, size_t levels);
+
+/** @brief Usuwa tablicę skoków.
+ * Nic nie robi, jeśli @p table ma wartość NULL.
+ * @param[in] table – wskaźnik na usuwaną tablicę.
+ */
+void jumpDelete(JumpTable *table);
+
+/** @brief Podaje liczbę poziomów tablicy skoków.
+ * @param[in] table – wskaźnik na tablicę.
+ * @return Liczba poziomów obejmowanych przez tablicę.
+ */
+size_t jumpLevels(JumpTable const *table);
+
+/** @brief Aktualizuje tablicę skoków.
+ * Wylicza na nowo pozycje tablicy dla numerów zaczynających się od
+ * @p length pierwszych cyfr @p prefix. Należy ją wywołać po zmianie
+ * przekierowania na głębokości co najwyżej liczby poziomów tablicy i po
+ * usunięciu węzłów z tych poziomów. Samo dodanie węzłów nie wymaga
+ * aktualizacji.
+ * @param[in,out] table – wskaźnik na tablicę;
+ * @param[in] prefix – wskaźnik na numer;
+ * @param[in] length – długość prefiksu, nie większa niż liczba poziomów
+ *                     tablicy i długość numeru.
+ */
+void jumpUpdate(JumpTable *table, char const *prefix, size_t length);
+
+/** @brief Szuka najdłuższego prefiksu numeru, który ma przekierowanie.
+ * Działa jak funkcja @ref findLongest wywołana dla korzenia drzewa, ale
+ * pomija poziomy drzewa obejmowane przez tablicę.
+ * @param[in] table – wskaźnik na tablicę;
+ * @param[in, out] num – wskaźnik na numer.
+ * @return Wskaźnik na węzeł reprezentujący najdłuższą ścieżkę.
+ */
+Node *jumpFindLongest(JumpTable const *table, char const **num);
+
+#endif //PHONE_NUMBERS_JUMP_H
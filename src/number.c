@@ -0,0 +1,209 @@
+/** @file
+ * Implementacja spakowanych numerów telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "number.h"
+#include "tree.h"
+
+/** @brief Odczytuje liczbę cyfr numeru.
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[out] length – wskaźnik na liczbę cyfr.
+ * @return Wskaźnik na pierwszy bajt cyfr numeru.
+ */
+static Number const *readLength(Number const *num, size_t *length) {
+    size_t value = 0;
+    unsigned shift = 0;
+    while (num[0] & 0x80) {
+        value |= (size_t) (num[0] & 0x7f) << shift;
+        shift += 7;
+        num++;
+    }
+    *length = value | (size_t) num[0] << shift;
+    return num + 1;
+}
+
+/** @brief Zapisuje liczbę cyfr numeru.
+ * @param[out] out – wskaźnik na początek numeru;
+ * @param[in] length – liczba cyfr.
+ * @return Wskaźnik na pierwszy bajt cyfr numeru.
+ */
+static Number *writeLength(Number *out, size_t length) {
+    while (length >= 0x80) {
+        *out++ = (Number) ((length & 0x7f) | 0x80);
+        length >>= 7;
+    }
+    *out++ = (Number) length;
+    return out;
+}
+
+/** @brief Podaje zapisaną wartość cyfry.
+ * @param[in] digits – wskaźnik na bajty cyfr numeru;
+ * @param[in] index – pozycja cyfry.
+ * @return Wartość cyfry powiększona o 1 lub 0 za ostatnią cyfrą.
+ */
+static inline unsigned nibble(Number const *digits, size_t index) {
+    return index % 2 == 0 ? digits[index / 2] >> 4 : digits[index / 2] & 0xf;
+}
+
+/** @brief Dopisuje cyfry napisu do bajtów cyfr numeru.
+ * @param[in,out] digits – wskaźnik na wyzerowane za pozycją @p index bajty
+ *                         cyfr numeru;
+ * @param[in] index – pozycja pierwszej dopisywanej cyfry;
+ * @param[in] text – wskaźnik na napis reprezentujący cyfry.
+ */
+static void writeDigits(Number *digits, size_t index, char const *text) {
+    for (; text[0] != '\0'; text++, index++) {
+        unsigned value = (unsigned) digitFinder(text[0]) + 1;
+        digits[index / 2] |= (Number) (index % 2 == 0 ? value << 4 : value);
+    }
+}
+
+size_t numberSize(size_t length) {
+    size_t bytes = 1;
+    for (size_t rest = length; rest >= 0x80; rest >>= 7)
+        bytes++;
+    return bytes + (length + 1) / 2;
+}
+
+size_t numberLength(Number const *num) {
+    size_t length;
+    readLength(num, &length);
+    return length;
+}
+
+size_t numberBytes(Number const *num) {
+    return numberSize(numberLength(num));
+}
+
+size_t numberDigit(Number const *num, size_t index) {
+    size_t length;
+    Number const *digits = readLength(num, &length);
+    return nibble(digits, index) - 1;
+}
+
+void numberEncode(Number *out, char const *prefix, char const *suffix) {
+    size_t length = strlen(prefix), total = length + strlen(suffix);
+    Number *digits = writeLength(out, total);
+    memset(digits, 0, (total + 1) / 2);
+    writeDigits(digits, 0, prefix);
+    writeDigits(digits, length, suffix);
+}
+
+Number *numberNew(char const *prefix, char const *suffix) {
+    Number *num = malloc(numberSize(strlen(prefix) + strlen(suffix)));
+    if (num != NULL)
+        numberEncode(num, prefix, suffix);
+    return num;
+}
+
+Number *numberAppend(Number const *prefix, char const *suffix) {
+    size_t length, extra = strlen(suffix);
+    Number const *source = readLength(prefix, &length);
+    Number *num = malloc(numberSize(length + extra));
+    if (num == NULL)
+        return NULL;
+    Number *digits = writeLength(num, length + extra);
+    // Połówka dopełnienia prefiksu jest zerem, więc dopisywane cyfry można
+    // łączyć z jego ostatnim bajtem.
+    memcpy(digits, source, (length + 1) / 2);
+    memset(digits + (length + 1) / 2, 0,
+           (length + extra + 1) / 2 - (length + 1) / 2);
+    writeDigits(digits, length, suffix);
+    return num;
+}
+
+void numberDecode(Number const *num, char *text) {
+    size_t length;
+    Number const *digits = readLength(num, &length);
+    for (size_t i = 0; i < length; i++)
+        text[i] = digitChar(nibble(digits, i) - 1);
+    text[length] = '\0';
+}
+
+char *numberText(Number const *num) {
+    char *text = malloc(numberLength(num) + 1);
+    if (text != NULL)
+        numberDecode(num, text);
+    return text;
+}
+
+bool numberPrint(Number const *num, FILE *file) {
+    size_t length;
+    Number const *digits = readLength(num, &length);
+    for (size_t i = 0; i < length; i++)
+        if (putc(digitChar(nibble(digits, i) - 1), file) == EOF)
+            return false;
+    return true;
+}
+
+/** @brief Odczytuje słowo bajtów cyfr.
+ * @param[in] bytes – wskaźnik na co najmniej 8 bajtów.
+ * @return Bajty zinterpretowane jako liczba zapisana od najstarszego bajtu.
+ */
+static inline uint64_t loadWord(Number const *bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+int numberCompare(Number const *a, Number const *b) {
+    size_t lengthA, lengthB;
+    Number const *digitsA = readLength(a, &lengthA);
+    Number const *digitsB = readLength(b, &lengthB);
+    size_t bytesA = (lengthA + 1) / 2, bytesB = (lengthB + 1) / 2;
+    size_t common = bytesA < bytesB ? bytesA : bytesB;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= common; i += sizeof(uint64_t)) {
+        uint64_t wordA = loadWord(digitsA + i), wordB = loadWord(digitsB + i);
+        if (wordA != wordB)
+            return wordA < wordB ? -1 : 1;
+    }
+    for (; i < common; i++)
+        if (digitsA[i] != digitsB[i])
+            return digitsA[i] < digitsB[i] ? -1 : 1;
+    // Wspólne bajty są równe, więc krótszy numer jest prefiksem dłuższego.
+    return (lengthA > lengthB) - (lengthA < lengthB);
+}
+
+int numberCompareText(Number const *num, char const *text, size_t length) {
+    size_t digitsLength;
+    Number const *digits = readLength(num, &digitsLength);
+    for (size_t i = 0; i < digitsLength && i < length; i++) {
+        size_t a = nibble(digits, i) - 1, b = digitFinder(text[i]);
+        if (a != b)
+            return a < b ? -1 : 1;
+    }
+    return (digitsLength > length) - (digitsLength < length);
+}
+
+bool numberHasPrefix(Number const *num, char const *prefix) {
+    size_t length = strlen(prefix), numLength;
+    Number const *digits = readLength(num, &numLength);
+    if (numLength < length)
+        return false;
+    for (size_t i = 0; i < length; i++)
+        if (nibble(digits, i) - 1 != digitFinder(prefix[i]))
+            return false;
+    return true;
+}
+
+bool numberHasSuffix(Number const *num, size_t start, char const *suffix) {
+    size_t length;
+    Number const *digits = readLength(num, &length);
+    if (length - start != strlen(suffix))
+        return false;
+    for (size_t i = start; i < length; i++, suffix++)
+        if (nibble(digits, i) - 1 != digitFinder(suffix[0]))
+            return false;
+    return true;
+}
@@ -0,0 +1,139 @@
+/** @file
+ * Interfejs spakowanych numerów telefonów.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_NUMBERS_NUMBER_H
+#define PHONE_NUMBERS_NUMBER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * To jest typ bajtów spakowanego numeru. Numer zaczyna się od liczby cyfr
+ * zapisanej po 7 bitów w bajcie, od najmłodszych, z najstarszym bitem
+ * oznaczającym kolejny bajt. Po niej następują cyfry, po dwie w bajcie,
+ * zaczynając od starszej połówki. Cyfra o wartości d jest zapisana jako
+ * d + 1, a nieparzysta liczba cyfr jest dopełniana zerem, więc porównanie
+ * bajtów cyfr daje porządek numerów, w którym prefiks poprzedza swoje
+ * rozszerzenia.
+ */
+typedef unsigned char Number;
+
+/** @brief Podaje rozmiar spakowanego numeru.
+ * @param[in] length – liczba cyfr numeru.
+ * @return Liczba bajtów numeru o @p length cyfrach.
+ */
+size_t numberSize(size_t length);
+
+/** @brief Podaje liczbę cyfr numeru.
+ * @param[in] num – wskaźnik na spakowany numer.
+ * @return Liczba cyfr numeru @p num.
+ */
+size_t numberLength(Number const *num);
+
+/** @brief Podaje rozmiar spakowanego numeru.
+ * @param[in] num – wskaźnik na spakowany numer.
+ * @return Liczba bajtów zajmowanych przez numer @p num.
+ */
+size_t numberBytes(Number const *num);
+
+/** @brief Podaje cyfrę numeru.
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[in] index – pozycja cyfry, mniejsza od liczby cyfr numeru.
+ * @return Wartość cyfry w sensie funkcji @ref digitFinder.
+ */
+size_t numberDigit(Number const *num, size_t index);
+
+/** @brief Pakuje numer.
+ * Zapisuje pod adresem @p out numer złożony z cyfr @p prefix i @p suffix.
+ * @param[out] out – wskaźnik na co najmniej @ref numberSize bajtów dla
+ *                   łącznej liczby cyfr;
+ * @param[in] prefix – wskaźnik na napis reprezentujący początek numeru;
+ * @param[in] suffix – wskaźnik na napis reprezentujący koniec numeru.
+ */
+void numberEncode(Number *out, char const *prefix, char const *suffix);
+
+/** @brief Tworzy spakowany numer.
+ * Odpowiednik funkcji @ref numberEncode, który alokuje pamięć funkcją malloc.
+ * @param[in] prefix – wskaźnik na napis reprezentujący początek numeru;
+ * @param[in] suffix – wskaźnik na napis reprezentujący koniec numeru.
+ * @return Wskaźnik na numer, który trzeba zwolnić funkcją free, lub NULL,
+ *         jeśli nie udało się alokować pamięci.
+ */
+Number *numberNew(char const *prefix, char const *suffix);
+
+/** @brief Tworzy spakowany numer z przedłużenia numeru.
+ * Kopiuje bajty cyfr @p prefix i dopisuje za nimi cyfry @p suffix.
+ * @param[in] prefix – wskaźnik na spakowany początek numeru;
+ * @param[in] suffix – wskaźnik na napis reprezentujący koniec numeru.
+ * @return Wskaźnik na numer, który trzeba zwolnić funkcją free, lub NULL,
+ *         jeśli nie udało się alokować pamięci.
+ */
+Number *numberAppend(Number const *prefix, char const *suffix);
+
+/** @brief Rozpakowuje numer.
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[out] text – wskaźnik na bufor na @ref numberLength + 1 znaków.
+ */
+void numberDecode(Number const *num, char *text);
+
+/** @brief Tworzy napis reprezentujący numer.
+ * @param[in] num – wskaźnik na spakowany numer.
+ * @return Wskaźnik na napis, który trzeba zwolnić funkcją free, lub NULL,
+ *         jeśli nie udało się alokować pamięci.
+ */
+char *numberText(Number const *num);
+
+/** @brief Zapisuje numer do pliku.
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[in,out] file – wskaźnik na plik.
+ * @return Wartość @p true, jeśli zapis się powiódł.
+ */
+bool numberPrint(Number const *num, FILE *file);
+
+/** @brief Porównuje dwa numery.
+ * Porównuje numery leksykograficznie w porządku cyfr 0–9, *, #, przy czym
+ * prefiks poprzedza swoje rozszerzenia. Bajty cyfr są porównywane słowami
+ * 64-bitowymi.
+ * @param[in] a – wskaźnik na pierwszy spakowany numer;
+ * @param[in] b – wskaźnik na drugi spakowany numer.
+ * @return Wartość ujemna, 0 lub dodatnia, jeśli @p a jest odpowiednio
+ *         mniejszy, równy lub większy od @p b.
+ */
+int numberCompare(Number const *a, Number const *b);
+
+/** @brief Porównuje numer z napisem.
+ * Porównuje, w porządku funkcji @ref numberCompare, numer @p num z napisem
+ * złożonym z @p length pierwszych cyfr @p text.
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[in] text – wskaźnik na napis reprezentujący numer;
+ * @param[in] length – liczba porównywanych cyfr @p text, co najwyżej jego
+ *                     długość.
+ * @return Wartość ujemna, 0 lub dodatnia, jeśli @p num jest odpowiednio
+ *         mniejszy, równy lub większy od prefiksu @p text.
+ */
+int numberCompareText(Number const *num, char const *text, size_t length);
+
+/** @brief Sprawdza, czy numer zaczyna się od prefiksu.
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[in] prefix – wskaźnik na napis reprezentujący prefiks.
+ * @return Wartość @p true, jeśli @p prefix jest prefiksem @p num.
+ */
+bool numberHasPrefix(Number const *num, char const *prefix);
+
+/** @brief Sprawdza, czy numer kończy się zadanym napisem.
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[in] start – pozycja cyfry, od której zaczyna się sufiks, nie
+ *                    większa od liczby cyfr numeru;
+ * @param[in] suffix – wskaźnik na napis reprezentujący sufiks.
+ * @return Wartość @p true, jeśli cyfry @p num od pozycji @p start tworzą
+ *         dokładnie napis @p suffix.
+ */
+bool numberHasSuffix(Number const *num, size_t start, char const *suffix);
+
+#endif //PHONE_NUMBERS_NUMBER_H
@@ -6,12 +6,31 @@
  * @date 2022
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 #include "phone_forward.h"
+#include "journal.h"
+#include "build.h"
+#include "frozen.h"
+#include "jump.h"
+#include "replica.h"
+#include "feed.h"
 
+/**
+ * Rozmiar bufora pliku migawki.
+ */
+#define SAVE_BUFFER (1024 * 1024)
 
 /**
  * To jest implementacja struktury przechowującej przekierowania
@@ -20,17 +39,41 @@
 struct PhoneForward {
     Node *from; ///< korzeń drzewa z numerami przekierowywanymi
     Node *to; ///< korzeń drzewa z numerami, na które są przekierowania
+    Journal *journal; ///< dziennik operacji lub NULL, jeśli jest wyłączony
+    pid_t checkpoint; ///< proces zapisujący migawkę lub 0, jeśli go nie ma
+    long checkpointOffset; ///< pozycja dziennika w chwili utworzenia migawki
+    Frozen *frozen; ///< zamrożone drzewa lub NULL, jeśli ich nie ma
+    JumpTable *jump; ///< tablica skoków lub NULL, jeśli jest wyłączona
+    Replicas *replicas; ///< kopie opublikowanej migawki lub NULL
+    Feed *feed; ///< strumień zmian lub NULL, jeśli jest wyłączony
+    Memory memory; ///< źródło i liczniki pamięci węzłów i napisów drzew
+    bool lazyReverse; ///< czy drzewo @p to jest utrzymywane leniwie
+    bool reverseStale; ///< czy drzewo @p to jest porzucone i puste
+    size_t reverseIdle; ///< liczba zmian, po której drzewo @p to jest porzucane
+    size_t reverseChanges; ///< liczba zmian od ostatniego zapytania odwrotnego
+    pthread_mutex_t reverseLock; ///< blokada budowy porzuconego drzewa @p to
 };
 
 /**
  * To jest implementacja struktury przechowującej ciąg numerów telefonów.
  */
 struct PhoneNumbers {
-    char **numbers;    ///< tablica przechowująca numery telefonów
+    Number **numbers;  ///< spakowane numery wyznaczanego wyniku lub NULL
+    char **texts;      ///< rozpakowane numery gotowego wyniku lub NULL
     size_t size;       ///< aktualny rozmiar tablicy @p numbers
     size_t last;       ///< indeks wskazujący pierwsze wolne miejsce w tablicy
 };
 
+/**
+ * To jest implementacja struktury przechowującej ciąg zmian przekierowań.
+ */
+struct PhoneChanges {
+    char **from;  ///< prefiksy numerów, których dotyczą kolejne zmiany
+    char **to;    ///< prefiksy docelowe lub NULL dla usunięć
+    size_t size;  ///< aktualny rozmiar tablic @p from i @p to
+    size_t last;  ///< indeks wskazujący pierwsze wolne miejsce w tablicach
+};
+
 /** @brief Kopiuje tablicę wartości typu char.
  * Tworzy nową tablicę wartości typu char, a następnie przepisuje na nią
  * kolejne elementy @p str.
@@ -58,154 +101,488 @@ static inline PhoneNumbers *phnumNew(void) {
     PhoneNumbers *new = malloc(1 * sizeof(PhoneNumbers));
     if (new == NULL)
         return NULL;
-    new->numbers = malloc(sizeof(const char *));
+    new->numbers = malloc(sizeof(Number *));
     if (new->numbers == NULL) {
         free(new);
         return NULL;
     }
+    new->texts = NULL;
     new->size = 1;
     new->last = 0;
     return new;
 }
 
 /** @brief Dodaje numer.
- * Dodaje przekierowanie wszystkich numerów mających prefiks @p num1, na numery,
- * w których ten prefiks zamieniono odpowiednio na prefiks @p num2. Każdy numer
+ * Dodaje numer do struktury, jeśli jeszcze go w niej nie ma. Przejmuje
+ * numer @p number na własność i zwalnia go, jeśli nie trafił do struktury.
  * @param[in] phones – wskaźnik na strukturę przechowującą numery;
- * @param[in] number - numer, który ma być dodany.
+ * @param[in] number - spakowany numer, który ma być dodany, lub NULL.
  * @return Wartość @p true, jeśli dodawanie numeru powiodło się lub
- *         wartość @p false, jeśli wystąpił błąd pamięci. */
-static inline bool phnumAdd(PhoneNumbers *phones, char const *number) {
+ *         wartość @p false, jeśli wystąpił błąd pamięci lub @p number ma
+ *         wartość NULL. */
+static inline bool phnumAdd(PhoneNumbers *phones, Number *number) {
+    if (number == NULL)
+        return false;
     for (size_t i = 0; i < phones->last; i++) {
-        if (strcmp(phones->numbers[i], number) == 0) {
+        if (numberCompare(phones->numbers[i], number) == 0) {
+            free(number);
             return true;
         }
     }
     if (phones->size == phones->last) {
+        Number **ptr = realloc(phones->numbers,
+                               2 * phones->size * sizeof(Number *));
+        if (ptr == NULL) {
+            free(number);
+            return false;
+        }
+        phones->numbers = ptr;
         phones->size = 2 * phones->size;
-        char **ptr = realloc(phones->numbers,
-                             (phones->size) * sizeof(char const *));
+    }
+    phones->numbers[phones->last] = number;
+    phones->last = phones->last + 1;
+    return true;
+}
+
+/** @brief Dopisuje numer na koniec struktury.
+ * W przeciwieństwie do funkcji @ref phnumAdd nie sprawdza powtórzeń.
+ * Przejmuje spakowany numer @p number na własność.
+ * @param[in,out] phones – wskaźnik na strukturę przechowującą numery;
+ * @param[in] number – wskaźnik na zaalokowany numer.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci; wtedy @p number nie jest zwalniany.
+ */
+static bool phnumPush(PhoneNumbers *phones, Number *number) {
+    if (phones->size == phones->last) {
+        Number **ptr = realloc(phones->numbers,
+                               2 * phones->size * sizeof(Number *));
         if (ptr == NULL)
             return false;
-        else
-            phones->numbers = ptr;
+        phones->numbers = ptr;
+        phones->size *= 2;
     }
-    phones->numbers[phones->last] = copyString(number);
-    if (phones->numbers[phones->last] == NULL)
-        return false;
-    phones->last = phones->last + 1;
+    phones->numbers[phones->last++] = number;
     return true;
 }
 
-/** @brief Sprawdza, czy tablica wartości typu char to poprawny numer.
- * Sprawdza, czy tablica charów składa się z samych cyfr i kończy znakiem "\0".
- * @param[in] number – wskaźnik na tablicę wartości typu char, która
- *                     będzię sprawdzana.
- * @return Wartość @p true, jeśli @p number jest wskaźnikiem na tablicę
- *         poprawnie reprezentującą numer.
- *         Wartość @p false,  jeśli @p number jest wskaźnikiem na tablicę
- *         niepoprawnie reprezentującą numer.
+/** @brief Kończy wyznaczanie wyniku.
+ * Rozpakowuje wszystkie numery struktury do jednego bloku pamięci,
+ * zawierającego tablicę wskaźników na napisy i same napisy, i zwalnia
+ * spakowane numery. Nic nie robi, jeśli numery są już rozpakowane.
+ * @param[in,out] pnum – wskaźnik na strukturę przechowującą numery lub NULL.
+ * @return Wskaźnik na strukturę lub NULL, jeśli @p pnum ma wartość NULL lub
+ *         nie udało się alokować pamięci; struktura jest wtedy usuwana.
  */
-static inline bool isItNumber(char const *number) {
-    if (number == NULL)
-        return false;
-    if (number[0] == '\0')
-        return false;
-    size_t i = 0;
-    while (isdigit(number[i]) || number[i] == TEN || number[i] == ELEVEN)
-        i++;
-    if (number[i] == '\0')
-        return true;
-    else
-        return false;
+static PhoneNumbers *phnumFinish(PhoneNumbers *pnum) {
+    if (pnum == NULL || pnum->numbers == NULL)
+        return pnum;
+    char **texts = NULL;
+    if (pnum->last > 0) {
+        size_t size = pnum->last * sizeof(char *);
+        for (size_t i = 0; i < pnum->last; i++)
+            size += numberLength(pnum->numbers[i]) + 1;
+        texts = malloc(size);
+        if (texts == NULL) {
+            phnumDelete(pnum);
+            return NULL;
+        }
+        char *text = (char *) (texts + pnum->last);
+        for (size_t i = 0; i < pnum->last; i++) {
+            texts[i] = text;
+            numberDecode(pnum->numbers[i], text);
+            text += strlen(text) + 1;
+            free(pnum->numbers[i]);
+        }
+    }
+    free(pnum->numbers);
+    pnum->numbers = NULL;
+    pnum->texts = texts;
+    return pnum;
 }
 
-PhoneForward *phfwdNew(void) {
-    PhoneForward *new = malloc(1 * sizeof(PhoneForward));
+/** @brief Tworzy nową strukturę.
+ * Tworzy nową strukturę niezawierającą żadnych przekierowań, której drzewa
+ * mają alfabet złożony z @p width cyfr.
+ * @param[in] width – liczba cyfr alfabetu;
+ * @param[in] allocator – wskaźnik na funkcje przydziału pamięci lub NULL;
+ * @param[in] budget – limit pamięci w bajtach lub 0.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+static PhoneForward *phfwdNewWidth(size_t width,
+                                   PhoneAllocator const *allocator,
+                                   size_t budget) {
+    Memory memory = {NULL, NULL, NULL, budget, 0, 0, {NULL, NULL}, NULL, 0};
+    if (allocator != NULL) {
+        memory.allocate = allocator->allocate;
+        memory.release = allocator->release;
+        memory.data = allocator->data;
+    }
+    PhoneForward *new = memoryAlloc(&memory, sizeof(PhoneForward));
     if (new == NULL)
         return NULL;
     else {
-        new->from = nodeNew(NULL, 0);
-        if (new->from == NULL) {
-            free(new);
-            return NULL;
-        }
-        new->to = nodeNew(NULL, 0);
-        if (new->to == NULL) {
-            free(new->from);
-            free(new);
-            return NULL;
-        }
-        new->to->backward = nodeNew(NULL, 0);
-        if (new->to->backward == NULL) {
-            free(new->from);
-            free(new->to);
-            free(new);
+        new->memory = memory;
+        Memory *own = &new->memory;
+        new->from = nodeNew(own, NULL, 0, width);
+        new->to = nodeNew(own, NULL, 0, width);
+        if (new->to != NULL)
+            new->to->backward = nodeNew(own, NULL, 0, width);
+        if (new->from == NULL || new->to == NULL ||
+            new->to->backward == NULL ||
+            pthread_mutex_init(&new->reverseLock, NULL) != 0) {
+            if (new->to != NULL)
+                nodeFree(own, new->to->backward);
+            nodeFree(own, new->from);
+            nodeFree(own, new->to);
+            memory = new->memory;
+            memoryFree(&memory, new, sizeof(PhoneForward));
             return NULL;
         }
+        new->journal = NULL;
+        new->checkpoint = 0;
+        new->checkpointOffset = 0;
+        new->frozen = NULL;
+        new->jump = NULL;
+        new->replicas = NULL;
+        new->feed = NULL;
+        new->lazyReverse = false;
+        new->reverseStale = false;
+        new->reverseIdle = 0;
+        new->reverseChanges = 0;
     }
     return new;
 }
 
-void phfwdDelete(PhoneForward *pf) {
-    if (pf != NULL) {
-        completeDelete(pf->from);
-        completeDelete(pf->to);
-        free(pf);
+/** @brief Wycofuje opublikowaną migawkę.
+ * Wywoływana przed zmianą przekierowań, po której migawka przestaje być
+ * aktualna. Zapytania są wtedy obsługiwane przez drzewa aż do ponownej
+ * publikacji.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania.
+ */
+static void unpublish(PhoneForward *pf) {
+    replicasDelete(pf->replicas);
+    pf->replicas = NULL;
+}
+
+/** @brief Podaje zamrożone drzewa, z których należy odpowiadać na zapytania.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania.
+ * @return Wskaźnik na kopię opublikowanej migawki najbliższą wywołującemu
+ *         wątkowi, na zamrożone drzewa struktury lub NULL, jeśli na zapytania
+ *         odpowiadają drzewa.
+ */
+static inline Frozen const *snapshot(PhoneForward const *pf) {
+    if (pf->replicas != NULL)
+        return replicasLocal(pf->replicas);
+    return pf->frozen;
+}
+
+/** @brief Porzuca indeks odwrotny.
+ * Usuwa wszystkie węzły drzewa @p to poza korzeniem, tak aby zmiany
+ * przekierowań nie musiały go aktualizować.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania.
+ */
+static void reverseDrop(PhoneForward *pf) {
+    for (size_t i = 0; i < pf->to->width; i++) {
+        completeDelete(&pf->memory, pf->to->numbers[i]);
+        pf->to->numbers[i] = NULL;
     }
+    pf->reverseStale = true;
 }
 
-bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
-    if (pf == NULL || !isItNumber(num1) || !isItNumber(num2) ||
-        !strcmp(num1, num2))
+/** @brief Dodaje przekierowanie do indeksu odwrotnego.
+ * @param[in] node – wskaźnik na węzeł drzewa przekierowań z przekierowaniem;
+ * @param[in,out] data – wskaźnik na strukturę przechowującą przekierowania.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool reverseAdd(Node *node, void *data) {
+    PhoneForward *pf = data;
+    Memory *memory = &pf->memory;
+    Node *to = findOrCreateNumberNode(memory, pf->to, node->value, 0);
+    if (to == NULL)
         return false;
-    Node *from = findOrCreateNode(pf->from, num1);
-    if (from == NULL)
+    if (to->value == NULL &&
+        (to->value = stringCopy(memory, node->value)) == NULL)
         return false;
-    Node *to = findOrCreateNode(pf->to, num2);
-    if (to == NULL)
+    if (to->backward == NULL &&
+        (to->backward = nodeNew(memory, NULL, 0, to->width)) == NULL)
         return false;
-    char *new_value_from = copyString(num2);
-    char *new_mine = copyString(num1);
-    char *new_value_to = copyString(num2);
-    char *new_value_subtree = copyString(num1);
-    if (new_value_from == NULL || new_mine == NULL || new_value_to == NULL) {
-        multiFree(4, new_value_from, new_mine, new_value_to,
-                  new_value_subtree);
+    Node *subtree = findOrCreateNumberNode(memory, to->backward, node->mine, 0);
+    if (subtree == NULL)
         return false;
+    if (subtree->value == NULL &&
+        (subtree->value = stringCopy(memory, node->mine)) == NULL)
+        return false;
+    return true;
+}
+
+/** @brief Przygotowuje indeks odwrotny do zapytania.
+ * W trybie leniwym buduje porzucony indeks z drzewa przekierowań i zeruje
+ * licznik zmian bez zapytań odwrotnych. Robi to pod blokadą struktury, więc
+ * równoległe zapytania nie ścigają się o indeks: każde z nich czyta drzewo
+ * @p to dopiero po zbudowaniu go przez to lub inne zapytanie.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania.
+ * @return Wartość @p true, jeśli indeks jest aktualny, lub @p false, jeśli
+ *         nie udało się alokować pamięci; indeks pozostaje wtedy porzucony.
+ */
+static bool reverseReady(PhoneForward const *pf) {
+    if (!pf->lazyReverse)
+        return true;
+    // Struktury są zawsze alokowane jako modyfikowalne, a w trybie leniwym
+    // zapytania odwrotne mogą ją zmieniać, co opisuje phfwdSetLazyReverse.
+    PhoneForward *own = (PhoneForward *) pf;
+    pthread_mutex_lock(&own->reverseLock);
+    own->reverseChanges = 0;
+    bool ready = !own->reverseStale;
+    if (!ready) {
+        own->reverseStale = false;
+        ready = nodeForEach(own->from, reverseAdd, own);
+        if (!ready)
+            reverseDrop(own);
     }
-    if (to->backward == NULL) {
-        to->backward = nodeNew(NULL, 0);
-        if (to->backward == NULL) {
-            multiFree(4, new_value_from, new_mine, new_value_to,
-                      new_value_subtree);
-            return false;
-        }
+    pthread_mutex_unlock(&own->reverseLock);
+    return ready;
+}
+
+/** @brief Odnotowuje zmianę przekierowań.
+ * Porzuca indeks odwrotny, jeśli od ostatniego zapytania odwrotnego
+ * wykonano @p pf->reverseIdle zmian.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania.
+ */
+static void reverseChanged(PhoneForward *pf) {
+    if (pf->lazyReverse && !pf->reverseStale && pf->reverseIdle > 0 &&
+        ++pf->reverseChanges >= pf->reverseIdle)
+        reverseDrop(pf);
+}
+
+PhoneForward *phfwdNew(void) {
+    return phfwdNewWidth(DIGITS, NULL, 0);
+}
+
+PhoneForward *phfwdNewDecimal(void) {
+    return phfwdNewWidth(DECIMAL_DIGITS, NULL, 0);
+}
+
+PhoneForward *phfwdNewWithAllocator(PhoneAlphabet alphabet,
+                                    PhoneAllocator const *allocator,
+                                    size_t budget) {
+    if ((alphabet != PHONE_ALPHABET_FULL &&
+         alphabet != PHONE_ALPHABET_DECIMAL) ||
+        (allocator != NULL &&
+         (allocator->allocate == NULL || allocator->release == NULL)))
+        return NULL;
+    size_t width = alphabet == PHONE_ALPHABET_FULL ? DIGITS : DECIMAL_DIGITS;
+    return phfwdNewWidth(width, allocator, budget);
+}
+
+PhoneForward *phfwdBuild(char const *const *num1s, char const *const *num2s,
+                         size_t count, size_t threads) {
+    if (count > 0 && (num1s == NULL || num2s == NULL))
+        return NULL;
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t) online : 1;
+    }
+    PhoneForward *pf = phfwdNew();
+    if (pf != NULL && !buildTrees(&pf->memory, pf->from, pf->to, num1s, num2s,
+                                  count, threads)) {
+        phfwdDelete(pf);
+        return NULL;
+    }
+    return pf;
+}
+
+size_t phfwdMemoryLive(PhoneForward const *pf) {
+    return pf != NULL ? pf->memory.live : 0;
+}
+
+size_t phfwdMemoryPeak(PhoneForward const *pf) {
+    return pf != NULL ? pf->memory.peak : 0;
+}
+
+void phfwdDelete(PhoneForward *pf) {
+    if (pf != NULL) {
+        phfwdCheckpointFinish(pf, true);
+        journalClose(pf->journal);
+        completeDelete(&pf->memory, pf->from);
+        completeDelete(&pf->memory, pf->to);
+        memoryTrim(&pf->memory, NULL, 0);
+        frozenDelete(pf->frozen);
+        jumpDelete(pf->jump);
+        replicasDelete(pf->replicas);
+        feedDelete(pf->feed);
+        pthread_mutex_destroy(&pf->reverseLock);
+        Memory memory = pf->memory;
+        memoryFree(&memory, pf, sizeof(PhoneForward));
+    }
+}
+
+/** @brief Liczy węzły brakujące na ścieżce numeru.
+ * @param[in] node – wskaźnik na korzeń drzewa lub NULL;
+ * @param[in] num – wskaźnik na numer.
+ * @return Liczba węzłów, które utworzyłaby funkcja @ref findOrCreateNode.
+ */
+static size_t missingNodes(Node const *node, char const *num) {
+    size_t length = strlen(num);
+    if (node == NULL)
+        return length;
+    size_t depth = 0;
+    while (depth < length) {
+        size_t digit = digitFinder(num[depth]);
+        if (digit >= node->width || node->numbers[digit] == NULL)
+            break;
+        node = node->numbers[digit];
+        depth++;
     }
-    Node *subtree = findOrCreateNode(to->backward, num1);
-    if (subtree == NULL) {
-        multiFree(4, new_value_from, new_mine, new_value_to,
-                  new_value_subtree);
+    return length - depth;
+}
+
+/** @brief Liczy pamięć potrzebną do dodania przekierowania.
+ * Uwzględnia węzły, których brakuje w drzewach, i nowe napisy, a jeśli indeks
+ * odwrotny jest porzucony, tylko te w drzewie przekierowań. Napisy z puli
+ * kosztują nowy blok, jeśli zabraknie dla nich wolnych miejsc. Stare napisy
+ * są zwalniane dopiero po utworzeniu nowych, więc nie są odliczane.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num1 – wskaźnik na numer przekierowywany;
+ * @param[in] num2 – wskaźnik na numer docelowy.
+ * @return Liczba bajtów, o którą może wzrosnąć zajęta pamięć.
+ */
+static size_t addCost(PhoneForward const *pf, char const *num1,
+                      char const *num2) {
+    Memory const *memory = &pf->memory;
+    if (pf->reverseStale)
+        return missingNodes(pf->from, num1) * nodeSize(pf->from->width) +
+               stringsCost(memory, 2, num1, num2);
+    Node const *to = findNode(pf->to, num2);
+    size_t nodes = missingNodes(pf->from, num1) + missingNodes(pf->to, num2);
+    if (to != NULL && to->backward != NULL)
+        nodes += missingNodes(to->backward, num1);
+    else
+        nodes += strlen(num1) + 1;
+    return nodes * nodeSize(pf->from->width) +
+           stringsCost(memory, 4, num1, num2, num2, num1);
+}
+
+bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
+    if (pf == NULL || pf->frozen != NULL || !isItNumber(num1) ||
+        !isItNumber(num2) || !strcmp(num1, num2))
+        return false;
+    if (pf->from->width < DIGITS &&
+        (!fitsAlphabet(num1, pf->from->width) ||
+         !fitsAlphabet(num2, pf->from->width)))
+        return false;
+    Memory *memory = &pf->memory;
+    if (memory->budget > 0 && !memoryFits(memory, addCost(pf, num1, num2)))
+        return false;
+    unpublish(pf);
+    bool reverse = !pf->reverseStale;
+    // Głębokość pierwszego węzła ścieżki, który zmieni się w drzewie:
+    // pierwszego tworzonego albo, jeśli żaden nie powstanie, węzła num1.
+    size_t length = strlen(num1);
+    size_t changedDepth = pf->jump != NULL
+                          ? length - missingNodes(pf->from, num1) : length;
+    if (changedDepth < length)
+        changedDepth++;
+    Node *from = findOrCreateNode(memory, pf->from, num1);
+    Node *to = from != NULL && reverse ? findOrCreateNode(memory, pf->to, num2)
+                                       : NULL;
+    if (to != NULL && to->backward == NULL)
+        to->backward = nodeNew(memory, NULL, 0, to->width);
+    Node *subtree = to != NULL && to->backward != NULL
+                    ? findOrCreateNode(memory, to->backward, num1) : NULL;
+    bool placed = from != NULL && (!reverse || subtree != NULL);
+    Number *new_value_from = placed ? stringNew(memory, num2) : NULL;
+    Number *new_mine = placed ? stringNew(memory, num1) : NULL;
+    Number *new_value_to = placed && reverse ? stringNew(memory, num2) : NULL;
+    Number *new_value_subtree = placed && reverse ? stringNew(memory, num1)
+                                                  : NULL;
+    if (new_value_from == NULL || new_mine == NULL ||
+        (reverse && (new_value_to == NULL || new_value_subtree == NULL))) {
+        // Wycofujemy węzły utworzone dla tego przekierowania.
+        multiStringFree(memory, 4, new_value_from, new_mine, new_value_to,
+                        new_value_subtree);
+        nodePrune(memory, subtree);
+        nodePrune(memory, to);
+        nodePrune(memory, from);
         return false;
     }
-    if (from->value != NULL) {
-        Node *old = findNode(pf->to, from->value);
-        Node *to_delete = findNode(old->backward, from->mine);
-        free(to_delete->value);
+    bool changed = from->value == NULL ||
+                   numberCompare(from->value, new_value_from) != 0;
+    nodeAddHash(from, forwardHash(new_mine, new_value_from) -
+                      (from->value != NULL
+                       ? forwardHash(new_mine, from->value) : 0));
+    if (reverse && from->value != NULL) {
+        Node *old = findNumberNode(pf->to, from->value);
+        Node *to_delete = findNumberNode(old->backward, from->mine);
+        stringFree(memory, to_delete->value);
         to_delete->value = NULL;
     }
-    multiFree(4, subtree->value, from->value, from->mine, to->value);
-    subtree->value = new_value_subtree;
+    if (reverse) {
+        multiStringFree(memory, 2, subtree->value, to->value);
+        subtree->value = new_value_subtree;
+        to->value = new_value_to;
+    }
+    multiStringFree(memory, 2, from->value, from->mine);
     from->value = new_value_from;
     from->mine = new_mine;
-    to->value = new_value_to;
+    if (pf->jump != NULL && changedDepth <= jumpLevels(pf->jump))
+        jumpUpdate(pf->jump, num1, changedDepth);
+    if (pf->feed != NULL && changed)
+        feedPush(pf->feed, new_mine, new_value_from);
+    reverseChanged(pf);
+    // Zapisujemy dopiero wykonane dodanie, aby odtworzenie dziennika nie
+    // dodało przekierowania, którego nie udało się dodać.
+    return pf->journal == NULL || journalAdd(pf->journal, num1, num2);
+}
+
+/** @brief Aktualizuje tablicę skoków po usunięciu przekierowań.
+ * Usunięcie przekierowań numeru @p num usuwa węzły jego ścieżki poniżej
+ * najgłębszego zachowanego węzła, więc wylicza na nowo pozycje tablicy dla
+ * numerów przechodzących przez pierwszy usunięty węzeł.
+ * @param[in,out] jump – wskaźnik na tablicę skoków;
+ * @param[in] root – wskaźnik na korzeń drzewa przekierowań;
+ * @param[in] num – numer, którego przekierowania usunięto.
+ */
+static void updateAfterRemove(JumpTable *jump, Node *root, char const *num) {
+    size_t depth = 0;
+    size_t digit = digitFinder(num[0]);
+    while (num[depth] != '\0' && digit < root->width &&
+           root->numbers[digit] != NULL) {
+        root = root->numbers[digit];
+        depth++;
+        digit = digitFinder(num[depth]);
+    }
+    if (num[depth] != '\0' && depth < jumpLevels(jump))
+        jumpUpdate(jump, num, depth + 1);
+}
+
+/** @brief Zapisuje w strumieniu zmian usunięcie przekierowania.
+ * @param[in] node – wskaźnik na węzeł z usuwanym przekierowaniem;
+ * @param[in,out] data – wskaźnik na strumień zmian.
+ * @return Wartość @p true.
+ */
+static bool feedRemoved(Node *node, void *data) {
+    feedPush(data, node->mine, NULL);
     return true;
 }
 
 void phfwdRemove(PhoneForward *pf, char const *num) {
-    if (pf != NULL && isItNumber(num)) {
+    if (pf != NULL && pf->frozen == NULL && isItNumber(num)) {
+        if (pf->journal != NULL && !journalRemove(pf->journal, num))
+            return;
+        unpublish(pf);
         Node *to_remove = findNodeToRemove(pf->from, num);
-        nodeDelete(to_remove, pf->to);
+        if (to_remove != NULL)
+            nodeAddHash(to_remove->parent, -to_remove->hash);
+        if (to_remove != NULL && pf->feed != NULL)
+            nodeForEach(to_remove, feedRemoved, pf->feed);
+        nodeDelete(&pf->memory, to_remove,
+                   pf->reverseStale ? NULL : pf->to);
+        if (pf->jump != NULL && to_remove != NULL)
+            updateAfterRemove(pf->jump, pf->from, num);
+        if (to_remove != NULL)
+            reverseChanged(pf);
     }
 }
 
@@ -216,29 +593,58 @@ PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
     if (result == NULL)
         return NULL;
     if (!isItNumber(num))
-        return result;
+        return phnumFinish(result);
     const char *forward = num;
-    Node *longest = findLongest(pf->from, &forward);
-    assert(longest != NULL);
-    char *number;
-    if (longest->value != NULL) {
-        number = malloc(strlen(forward) + strlen(longest->value) + 1);
-        if (number == NULL) {
-            phnumDelete(result);
-            return NULL;
-        }
-        strcpy(number, longest->value);
-        number = strcat(number, forward);
+    Number *number;
+    Frozen const *frozen = snapshot(pf);
+    if (frozen != NULL) {
+        char const *value = frozenFindLongest(frozen, &forward);
+        number = value != NULL ? numberNew(value, forward)
+                               : numberNew(num, "");
     } else {
-        number = copyString(num);
+        Node *longest = pf->jump != NULL
+                        ? jumpFindLongest(pf->jump, &forward)
+                        : findLongest(pf->from, &forward);
+        assert(longest != NULL);
+        number = longest->value != NULL ? numberAppend(longest->value, forward)
+                                        : numberNew(num, "");
     }
     if (phnumAdd(result, number) == false) {
-        free(number);
         phnumDelete(result);
         return NULL;
     }
-    free(number);
-    return result;
+    return phnumFinish(result);
+}
+
+/** @brief Sprawdza, czy numer jest przekierowywany na zadany numer.
+ * Szuka najdłuższego przekierowanego prefiksu bezpośrednio na cyfrach
+ * spakowanego numeru, więc nie alokuje pamięci.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] number – wskaźnik na spakowany numer;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wartość @p true, jeśli @ref phfwdGet zwraca dla @p number numer
+ *         @p num.
+ */
+static bool forwardsTo(PhoneForward const *pf, Number const *number,
+                       char const *num) {
+    size_t depth;
+    Frozen const *frozen = snapshot(pf);
+    if (frozen != NULL) {
+        char const *value = frozenFindLongestNumber(frozen, number, &depth);
+        if (value == NULL)
+            return numberHasSuffix(number, 0, num);
+        size_t length = strlen(value);
+        return strncmp(value, num, length) == 0 &&
+               numberHasSuffix(number, depth, num + length);
+    }
+    Node *longest = findLongestNumber(pf->from, number, &depth);
+    assert(longest != NULL);
+    if (longest->value == NULL)
+        return numberHasSuffix(number, 0, num);
+    size_t length = numberLength(longest->value);
+    return strlen(num) >= length &&
+           numberCompareText(longest->value, num, length) == 0 &&
+           numberHasSuffix(number, depth, num + length);
 }
 
 /** @brief Uzupełnia tablicę numerów takimi numerami, które pochodzą od
@@ -259,9 +665,9 @@ static inline PhoneNumbers *
 findNumbers(Node *to, Node *from, PhoneForward const *pf, char const *num,
             PhoneNumbers *phones) {
     char const *what = num;
-    while (num[0] != '\0' && to != NULL && phones != NULL) {
+    while (num[0] != '\0' && to != NULL) {
         size_t digit = digitFinder(num[0]);
-        to = to->numbers[digit];
+        to = digit < to->width ? to->numbers[digit] : NULL;
         num = num + 1;
         Node *node;
         if (to != NULL)
@@ -270,38 +676,21 @@ findNumbers(Node *to, Node *from, PhoneForward const *pf, char const *num,
             node = NULL;
         size_t i = 0;
         while (node != NULL) {
-            while (i < DIGITS && node->numbers[i] == NULL && phones != NULL)
+            while (i < node->width && node->numbers[i] == NULL)
                 i++;
-            if (i == DIGITS) {
+            if (i == node->width) {
                 if (node->value != NULL) {
-                    char *number = malloc(
-                            strlen(num) + strlen(node->value) + 1);
-                    if (number == NULL) {
-                        phnumDelete(phones);
-                        phones = NULL;
-                    } else {
-                        strcpy(number, node->value);
-                        strcat(number, num);
-                        if (from != NULL && num[0] != '\0') {
-                            PhoneNumbers *found = phfwdGet(pf, number);
-                            if (found != NULL &&
-                                strcmp(phnumGet(found, 0), what) == 0) {
-                                if (!phnumAdd(phones, number)) {
-                                    free(number);
-                                    phnumDelete(phones);
-                                    phnumDelete(found);
-                                    return NULL;
-                                }
-                            }
-                            phnumDelete(found);
-                        } else {
-                            if (!phnumAdd(phones, number)) {
-                                free(number);
-                                phnumDelete(phones);
-                                return NULL;
-                            }
-                        }
+                    Number *number = numberAppend(node->value, num);
+                    bool ok = number != NULL, add = ok;
+                    if (ok && from != NULL && num[0] != '\0')
+                        add = forwardsTo(pf, number, what);
+                    if (add)
+                        ok = phnumAdd(phones, number);
+                    else
                         free(number);
+                    if (!ok) {
+                        phnumDelete(phones);
+                        return NULL;
                     }
                 }
                 i = node->index + 1;
@@ -318,7 +707,19 @@ findNumbers(Node *to, Node *from, PhoneForward const *pf, char const *num,
 }
 
 /** @brief Funkcja porównująca dwa numery telefonu.
- * Funkcja porównuje kepsykograficznie dwa numery telefonów.
+ * Funkcja porównuje leksykograficznie dwa spakowane numery telefonów.
+ * @param[in] val1 – wskaźnik na wskaźnik na pierwszy spakowany numer.
+ * @param[in] val2 – wskaźnik na wskaźnik na drugi spakowany numer.
+ * @return Wartość 0, jeśli numery są równe, -1, jeśli pierwszy numer jest
+ *         mniejszy i 1, jeśli drugi numer jest mniejszy.
+ */
+static inline int compare(const void *val1, const void *val2) {
+    return numberCompare(*(Number const *const *) val1,
+                         *(Number const *const *) val2);
+}
+
+/** @brief Funkcja porównująca dwa napisy reprezentujące numery telefonu.
+ * Odpowiednik funkcji @ref compare dla rozpakowanych numerów.
  * @param[in] val1 – wskaźnik na tablicę wartości typu char, preprezentującą
  *                  pierwszy numer.
  * @param[in] val2 – wskaźnik na tablicę wartości typu char, preprezentującą
@@ -326,7 +727,7 @@ findNumbers(Node *to, Node *from, PhoneForward const *pf, char const *num,
  * @return Wartość 0, jeśli numery są równe, -1, jeśli pierwszy numer jest
  *         mniejszy i 1, jeśli drugi numer jest mniejszy.
  */
-static inline int compare(const void *val1, const void *val2) {
+static inline int compareText(const void *val1, const void *val2) {
     char *num1 = *(char **) val1;
     char *num2 = *(char **) val2;
 
@@ -348,6 +749,205 @@ static inline int compare(const void *val1, const void *val2) {
     }
 }
 
+/** @brief Porównuje prefiks numeru z numerem.
+ * Porównuje, w porządku funkcji @ref compare, napis złożony z @p length
+ * pierwszych cyfr @p a z numerem @p b.
+ * @param[in] a – wskaźnik na numer, którego prefiks jest porównywany;
+ * @param[in] length – długość prefiksu;
+ * @param[in] b – wskaźnik na numer.
+ * @return Wartość ujemna, 0 lub dodatnia, jeśli prefiks jest odpowiednio
+ *         mniejszy, równy lub większy od @p b.
+ */
+static int comparePrefix(char const *a, size_t length, char const *b) {
+    size_t i = 0;
+    while (i < length && b[i] != '\0' && a[i] == b[i])
+        i++;
+    if (i == length)
+        return b[i] == '\0' ? 0 : -1;
+    if (b[i] == '\0')
+        return 1;
+    return digitFinder(a[i]) < digitFinder(b[i]) ? -1 : 1;
+}
+
+/** @brief Sprawdza, czy numer przechodzi przez filtr.
+ * Sprawdza warunki filtru, a jeśli wynik ma już @p filter->limit numerów,
+ * także to, czy numer jest mniejszy od największego z nich.
+ * @param[in] filter – wskaźnik na filtr;
+ * @param[in] phones – wskaźnik na posortowany wynik;
+ * @param[in] number – wskaźnik na spakowany numer.
+ * @return Wartość @p true, jeśli numer może trafić do wyniku.
+ */
+static bool passesFilter(PhoneFilter const *filter, PhoneNumbers const *phones,
+                         Number const *number) {
+    return (filter->prefix == NULL ||
+            numberHasPrefix(number, filter->prefix)) &&
+           (filter->lo == NULL ||
+            numberCompareText(number, filter->lo, strlen(filter->lo)) >= 0) &&
+           (filter->hi == NULL ||
+            numberCompareText(number, filter->hi, strlen(filter->hi)) < 0) &&
+           (filter->limit == 0 || phones->last < filter->limit ||
+            numberCompare(number, phones->numbers[phones->last - 1]) < 0);
+}
+
+/** @brief Sprawdza, czy numery o danym prefiksie mogą przejść przez filtr.
+ * Wszystkie numery o prefiksie @p path są od niego nie mniejsze, więc
+ * poddrzewo można pominąć, jeśli prefiks nie jest mniejszy od górnej
+ * granicy, jest mniejszy od dolnej granicy i nie jest jej prefiksem lub nie
+ * zgadza się z wymaganym prefiksem.
+ * @param[in] filter – wskaźnik na filtr;
+ * @param[in] phones – wskaźnik na posortowany wynik;
+ * @param[in] path – wskaźnik na prefiks;
+ * @param[in] length – długość prefiksu.
+ * @return Wartość @p false, jeśli żaden numer o prefiksie @p path nie może
+ *         trafić do wyniku.
+ */
+static bool prefixPassesFilter(PhoneFilter const *filter,
+                               PhoneNumbers const *phones, char const *path,
+                               size_t length) {
+    if (filter->prefix != NULL) {
+        size_t common = strlen(filter->prefix);
+        if (strncmp(path, filter->prefix, length < common ? length : common))
+            return false;
+    }
+    if (filter->hi != NULL && comparePrefix(path, length, filter->hi) >= 0)
+        return false;
+    if (filter->limit > 0 && phones->last == filter->limit &&
+        numberCompareText(phones->numbers[phones->last - 1], path,
+                          length) <= 0)
+        return false;
+    return filter->lo == NULL || comparePrefix(path, length, filter->lo) >= 0 ||
+           strncmp(path, filter->lo, length) == 0;
+}
+
+/** @brief Wstawia numer do posortowanego wyniku.
+ * Wstawia numer w miejsce wskazane przez funkcję @ref compare, o ile go tam
+ * jeszcze nie ma. Jeśli wynik ma więcej niż @p limit numerów, usuwa
+ * największy. Przejmuje numer @p number na własność i zwalnia go, jeśli nie
+ * trafił do wyniku.
+ * @param[in,out] phones – wskaźnik na posortowany wynik;
+ * @param[in] number – wskaźnik na spakowany numer;
+ * @param[in] limit – maksymalna liczba numerów lub 0, jeśli jej nie ma.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool phnumInsert(PhoneNumbers *phones, Number *number,
+                        size_t limit) {
+    size_t low = 0, high = phones->last;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        int result = numberCompare(phones->numbers[middle], number);
+        if (result == 0) {
+            free(number);
+            return true;
+        }
+        if (result < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (limit > 0 && low >= limit) {
+        free(number);
+        return true;
+    }
+    if (limit > 0 && phones->last == limit)
+        free(phones->numbers[--phones->last]);
+    if (phones->size == phones->last) {
+        Number **ptr = realloc(phones->numbers,
+                               2 * phones->size * sizeof(Number *));
+        if (ptr == NULL) {
+            free(number);
+            return false;
+        }
+        phones->numbers = ptr;
+        phones->size = 2 * phones->size;
+    }
+    memmove(&phones->numbers[low + 1], &phones->numbers[low],
+            (phones->last - low) * sizeof(Number *));
+    phones->numbers[low] = number;
+    phones->last++;
+    return true;
+}
+
+/** @brief Dodaje do wyniku numer znaleziony przy filtrowaniu.
+ * Jeśli numer przechodzi przez filtr i, gdy @p check ma wartość @p true, jest
+ * przekierowany na @p num, wstawia go do posortowanego wyniku. Przejmuje
+ * numer @p number na własność.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num – numer, dla którego szukane są numery;
+ * @param[in] number – wskaźnik na spakowany numer lub NULL;
+ * @param[in] check – czy sprawdzać numer funkcją @ref phfwdGet;
+ * @param[in] filter – wskaźnik na filtr;
+ * @param[in,out] phones – wskaźnik na posortowany wynik.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci lub @p number ma wartość NULL.
+ */
+static bool addFiltered(PhoneForward const *pf, char const *num,
+                        Number *number, bool check, PhoneFilter const *filter,
+                        PhoneNumbers *phones) {
+    if (number == NULL)
+        return false;
+    if (passesFilter(filter, phones, number) &&
+        (!check || forwardsTo(pf, number, num)))
+        return phnumInsert(phones, number, filter->limit);
+    free(number);
+    return true;
+}
+
+/**
+ * To jest struktura przechowująca stan wyszukiwania numerów w zamrożonych
+ * drzewach.
+ */
+typedef struct FrozenSearch {
+    PhoneForward const *pf; ///< struktura przechowująca przekierowania
+    char const *num;        ///< numer, dla którego szukane są numery
+    bool get;               ///< czy sprawdzać numery funkcją @ref phfwdGet
+    PhoneNumbers *phones;   ///< znalezione numery
+} FrozenSearch;
+
+/** @brief Dodaje numer znaleziony w zamrożonych drzewach.
+ * Składa numer z numeru @p mine przekierowanego na prefiks szukanego numeru
+ * i pozostałego sufiksu @p suffix, a następnie dodaje go do wyniku, tak jak
+ * funkcja @ref findNumbers.
+ * @param[in] mine – numer przekierowany na prefiks szukanego numeru;
+ * @param[in] suffix – sufiks szukanego numeru pozostający po prefiksie;
+ * @param[in,out] data – wskaźnik na strukturę typu FrozenSearch.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool addFrozenNumber(char const *mine, char const *suffix, void *data) {
+    FrozenSearch *search = data;
+    Number *number = numberNew(mine, suffix);
+    bool check = search->get && suffix[0] != '\0';
+    if (number == NULL)
+        return false;
+    if (!check || forwardsTo(search->pf, number, search->num))
+        return phnumAdd(search->phones, number);
+    free(number);
+    return true;
+}
+
+/** @brief Uzupełnia tablicę numerów numerami z zamrożonych drzew.
+ * Odpowiednik funkcji @ref findNumbers dla zamrożonej struktury.
+ * @param[in] frozen – wskaźnik na zamrożone drzewa;
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num – tablica wartości typu char, reprezentująca numer telefonu;
+ * @param[in] get – czy wynik ma spełniać specyfikację funkcji
+ *                  @ref phfwdGetReverse zamiast @ref phfwdReverse;
+ * @param[in, out] phones – wskaźnik na strukturę zawierającą tablicę numerów.
+ * @return wskaźnik na strukturę zawierającą tablicę numerów, lub NULL, jeśli
+ * nie udało się alokować pamięci.
+ */
+static PhoneNumbers *findFrozenNumbers(Frozen const *frozen,
+                                       PhoneForward const *pf, char const *num,
+                                       bool get, PhoneNumbers *phones) {
+    FrozenSearch search = {pf, num, get, phones};
+    if (!frozenForEachReverse(frozen, num, addFrozenNumber, &search)) {
+        phnumDelete(phones);
+        return NULL;
+    }
+    return phones;
+}
+
 PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
     if (pf == NULL)
         return NULL;
@@ -355,17 +955,25 @@ PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
     if (result == NULL)
         return NULL;
     if (!isItNumber(num))
-        return result;
-    if (phnumAdd(result, num) == false) {
+        return phnumFinish(result);
+    if (phnumAdd(result, numberNew(num, "")) == false) {
         phnumDelete(result);
         return NULL;
     }
-    result = findNumbers(pf->to, NULL, pf, num, result);
+    Frozen const *frozen = snapshot(pf);
+    if (frozen != NULL) {
+        result = findFrozenNumbers(frozen, pf, num, false, result);
+    } else if (!reverseReady(pf)) {
+        phnumDelete(result);
+        return NULL;
+    } else {
+        result = findNumbers(pf->to, NULL, pf, num, result);
+    }
     if (result != NULL)
-        qsort(result->numbers, result->last, sizeof(char *),
+        qsort(result->numbers, result->last, sizeof(Number *),
               compare);
 
-    return result;
+    return phnumFinish(result);
 }
 
 void phnumDelete(PhoneNumbers *pnum) {
@@ -373,15 +981,14 @@ void phnumDelete(PhoneNumbers *pnum) {
         if (pnum->numbers != NULL)
             for (size_t i = 0; i < pnum->last; i++)
                 free(pnum->numbers[i]);
-        multiFree(2, pnum->numbers, pnum);
+        multiFree(3, pnum->numbers, pnum->texts, pnum);
     }
 }
 
 char const *phnumGet(PhoneNumbers const *pnum, size_t idx) {
     if (pnum == NULL || idx >= pnum->last)
         return NULL;
-    char const *result = pnum->numbers[idx];
-    return result;
+    return pnum->texts[idx];
 }
 
 PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
@@ -391,21 +998,1050 @@ PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
     if (result == NULL)
         return NULL;
     if (!isItNumber(num))
-        return result;
-    result = findNumbers(pf->to, pf->from, pf, num, result);
-    PhoneNumbers *pnum;
-    pnum = phfwdGet(pf, num);
-    if (strcmp(phnumGet(pnum, 0), num) == 0) {
-        if (phnumAdd(result, num) == false) {
-            phnumDelete(result);
-            phnumDelete(pnum);
+        return phnumFinish(result);
+    Frozen const *frozen = snapshot(pf);
+    if (frozen != NULL) {
+        result = findFrozenNumbers(frozen, pf, num, true, result);
+    } else if (!reverseReady(pf)) {
+        phnumDelete(result);
+        return NULL;
+    } else {
+        result = findNumbers(pf->to, pf->from, pf, num, result);
+    }
+    if (result == NULL)
+        return NULL;
+    Number *number = numberNew(num, "");
+    bool ok = number != NULL;
+    if (ok && forwardsTo(pf, number, num))
+        ok = phnumAdd(result, number);
+    else
+        free(number);
+    if (!ok) {
+        phnumDelete(result);
+        return NULL;
+    }
+    qsort(result->numbers, result->last, sizeof(Number *), compare);
+
+    return phnumFinish(result);
+}
+
+/** @brief Uzupełnia wynik numerami przechodzącymi przez filtr.
+ * Odpowiednik funkcji @ref findNumbers, który pomija poddrzewa drzew
+ * odwróconych przekierowań, w których nie ma numerów przechodzących przez
+ * filtr, i od razu wstawia numery do posortowanego wyniku.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num – numer, dla którego szukane są numery;
+ * @param[in] get – czy wynik ma spełniać specyfikację funkcji
+ *                  @ref phfwdGetReverse zamiast @ref phfwdReverse;
+ * @param[in] filter – wskaźnik na filtr;
+ * @param[in,out] phones – wskaźnik na posortowany wynik.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool findFilteredNumbers(PhoneForward const *pf, char const *num,
+                                bool get, PhoneFilter const *filter,
+                                PhoneNumbers *phones) {
+    size_t size = 16;
+    char *path = malloc(size);
+    bool ok = path != NULL;
+    Node *to = pf->to;
+    char const *suffix = num;
+    while (ok && suffix[0] != '\0' && to != NULL) {
+        size_t digit = digitFinder(suffix[0]);
+        to = digit < to->width ? to->numbers[digit] : NULL;
+        suffix++;
+        Node *node = to != NULL ? to->backward : NULL;
+        size_t depth = 0, i = 0;
+        bool enter = true;
+        while (ok && node != NULL) {
+            if (enter) {
+                enter = false;
+                i = 0;
+                // Węzły odwiedzamy przed synami, więc numery trafiają do
+                // wyniku w porządku rosnącym i limit szybko zawęża zakres.
+                if (!prefixPassesFilter(filter, phones, path, depth))
+                    i = node->width;
+                else if (node->value != NULL)
+                    ok = addFiltered(pf, num,
+                                     numberAppend(node->value, suffix),
+                                     get && suffix[0] != '\0', filter,
+                                     phones);
+            }
+            while (i < node->width && node->numbers[i] == NULL)
+                i++;
+            if (i == node->width) {
+                i = node->index + 1;
+                node = node->parent;
+                depth = depth > 0 ? depth - 1 : 0;
+            } else {
+                if (depth + 1 == size) {
+                    char *ptr = realloc(path, 2 * size);
+                    if (ptr == NULL) {
+                        ok = false;
+                        break;
+                    }
+                    path = ptr;
+                    size *= 2;
+                }
+                path[depth++] = digitChar(i);
+                node = node->numbers[i];
+                enter = true;
+            }
+        }
+    }
+    free(path);
+    return ok;
+}
+
+/** @brief Szuka miejsca numeru w liście zamrożonych numerów.
+ * @param[in] list – wskaźnik na posortowaną listę numerów;
+ * @param[in] key – wskaźnik na numer;
+ * @param[in] length – długość prefiksu @p key, z którym porównywane są
+ *                     numery listy.
+ * @return Indeks pierwszego numeru listy nie mniejszego od prefiksu długości
+ *         @p length numeru @p key lub długość listy, jeśli takiego nie ma.
+ */
+static size_t frozenLowerBound(FrozenList const *list, char const *key,
+                               size_t length) {
+    size_t low = 0, high = list->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (comparePrefix(key, length, list->pool + list->offsets[middle]) > 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/** @brief Dodaje do wyniku numery listy będące prefiksami numeru.
+ * Spośród numerów listy leżących przed indeksem @p end dodaje funkcją
+ * @ref addFiltered te, które są właściwymi prefiksami numeru @p key.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num – numer, dla którego szukane są numery;
+ * @param[in] suffix – sufiks @p num pozostający po prefiksie listy;
+ * @param[in] get – czy wynik ma spełniać specyfikację funkcji
+ *                  @ref phfwdGetReverse zamiast @ref phfwdReverse;
+ * @param[in] filter – wskaźnik na filtr;
+ * @param[in] list – wskaźnik na posortowaną listę numerów;
+ * @param[in] key – wskaźnik na numer lub NULL;
+ * @param[in] end – indeks, przed którym leżą rozważane numery;
+ * @param[in,out] phones – wskaźnik na posortowany wynik.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool addFrozenPrefixes(PhoneForward const *pf, char const *num,
+                              char const *suffix, bool get,
+                              PhoneFilter const *filter,
+                              FrozenList const *list, char const *key,
+                              size_t end, PhoneNumbers *phones) {
+    bool ok = true;
+    for (size_t length = 1; ok && key != NULL && key[length] != '\0';
+         length++) {
+        size_t i = frozenLowerBound(list, key, length);
+        char const *mine = i < end ? list->pool + list->offsets[i] : NULL;
+        if (mine != NULL && comparePrefix(key, length, mine) == 0)
+            ok = addFiltered(pf, num, numberNew(mine, suffix),
+                             get && suffix[0] != '\0', filter, phones);
+    }
+    return ok;
+}
+
+/** @brief Uzupełnia wynik numerami z zamrożonych drzew przechodzącymi przez
+ * filtr.
+ * Odpowiednik funkcji @ref findFilteredNumbers dla zamrożonej struktury.
+ * Listy numerów przekierowanych na prefiksy @p num są posortowane, więc
+ * przegląda każdą od pierwszego numeru nie mniejszego od dolnej granicy
+ * i wymaganego prefiksu, znalezionego wyszukiwaniem binarnym, do pierwszego
+ * numeru, który nie może przejść przez filtr. Mniejsze numery mogą trafić do
+ * wyniku tylko wtedy, gdy są prefiksami dolnej granicy lub wymaganego
+ * prefiksu, więc są wyszukiwane osobno.
+ * @param[in] frozen – wskaźnik na zamrożone drzewa;
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num – numer, dla którego szukane są numery;
+ * @param[in] get – czy wynik ma spełniać specyfikację funkcji
+ *                  @ref phfwdGetReverse zamiast @ref phfwdReverse;
+ * @param[in] filter – wskaźnik na filtr;
+ * @param[in,out] phones – wskaźnik na posortowany wynik.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool findFrozenFiltered(Frozen const *frozen, PhoneForward const *pf,
+                               char const *num, bool get,
+                               PhoneFilter const *filter,
+                               PhoneNumbers *phones) {
+    FrozenList *lists = malloc(strlen(num) * sizeof(FrozenList));
+    if (lists == NULL)
+        return false;
+    size_t count = frozenReverseLists(frozen, num, lists);
+    bool ok = true;
+    for (size_t i = 0; ok && i < count; i++) {
+        FrozenList const *list = &lists[i];
+        char const *suffix = num + i + 1;
+        size_t start = 0;
+        if (filter->lo != NULL)
+            start = frozenLowerBound(list, filter->lo, strlen(filter->lo));
+        if (filter->prefix != NULL) {
+            size_t first = frozenLowerBound(list, filter->prefix,
+                                            strlen(filter->prefix));
+            start = first > start ? first : start;
+        }
+        ok = addFrozenPrefixes(pf, num, suffix, get, filter, list,
+                               filter->lo, start, phones) &&
+             addFrozenPrefixes(pf, num, suffix, get, filter, list,
+                               filter->prefix, start, phones);
+        for (size_t j = start; ok && j < list->count; j++) {
+            char const *mine = list->pool + list->offsets[j];
+            // Warunki są monotoniczne względem kolejności listy, więc za
+            // pierwszym odrzuconym numerem nie ma już pasujących.
+            if (!prefixPassesFilter(filter, phones, mine, strlen(mine)))
+                break;
+            ok = addFiltered(pf, num, numberNew(mine, suffix),
+                             get && suffix[0] != '\0', filter, phones);
+        }
+    }
+    free(lists);
+    return ok;
+}
+
+/** @brief Wyznacza przefiltrowany wynik zapytania odwrotnego.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num – wskaźnik na numer;
+ * @param[in] get – czy wynik ma spełniać specyfikację funkcji
+ *                  @ref phfwdGetReverse zamiast @ref phfwdReverse;
+ * @param[in] filter – wskaźnik na filtr.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub argumenty są niepoprawne.
+ */
+static PhoneNumbers *reverseFiltered(PhoneForward const *pf, char const *num,
+                                     bool get, PhoneFilter const *filter) {
+    if (pf == NULL || filter == NULL ||
+        (filter->lo != NULL && !isItNumber(filter->lo)) ||
+        (filter->hi != NULL && !isItNumber(filter->hi)) ||
+        (filter->prefix != NULL && !isItNumber(filter->prefix)))
+        return NULL;
+    PhoneNumbers *result = phnumNew();
+    if (result == NULL || !isItNumber(num))
+        return phnumFinish(result);
+    bool ok = addFiltered(pf, num, numberNew(num, ""), get, filter, result);
+    Frozen const *frozen = snapshot(pf);
+    if (ok && frozen != NULL)
+        ok = findFrozenFiltered(frozen, pf, num, get, filter, result);
+    else if (ok)
+        ok = reverseReady(pf) && findFilteredNumbers(pf, num, get, filter,
+                                                     result);
+    if (!ok) {
+        phnumDelete(result);
+        return NULL;
+    }
+    return phnumFinish(result);
+}
+
+PhoneNumbers *phfwdReverseFiltered(PhoneForward const *pf, char const *num,
+                                   PhoneFilter const *filter) {
+    return reverseFiltered(pf, num, false, filter);
+}
+
+PhoneNumbers *phfwdGetReverseFiltered(PhoneForward const *pf, char const *num,
+                                      PhoneFilter const *filter) {
+    return reverseFiltered(pf, num, true, filter);
+}
+
+/**
+ * To jest struktura przechowująca stos numerów zebranych z drzew odwróconych
+ * przekierowań węzłów leżących na ścieżce w drzewie @p to.
+ */
+typedef struct BatchPath {
+    Node **nodes;        ///< węzły drzewa @p to na ścieżce
+    size_t *ends;        ///< koniec numerów każdego poziomu na stosie
+    Number const **values; ///< stos numerów przekierowanych na prefiksy ścieżki
+    size_t size;         ///< rozmiar tablicy @p values
+    size_t last;         ///< liczba numerów na stosie
+    size_t depth;        ///< liczba poziomów ścieżki
+} BatchPath;
+
+/** @brief Odkłada numer przekierowywany na stos ścieżki.
+ * @param[in] node – wskaźnik na węzeł drzewa odwróconych przekierowań;
+ * @param[in,out] data – wskaźnik na strukturę @ref BatchPath.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool pushValue(Node *node, void *data) {
+    BatchPath *path = data;
+    if (path->last == path->size) {
+        Number const **ptr = realloc(path->values,
+                                     2 * path->size * sizeof(Number const *));
+        if (ptr == NULL)
+            return false;
+        path->values = ptr;
+        path->size *= 2;
+    }
+    path->values[path->last++] = node->value;
+    return true;
+}
+
+/** @brief Przesuwa ścieżkę w drzewie @p to do kolejnego numeru.
+ * Zostawia poziomy wspólne z poprzednim numerem i schodzi dalej wzdłuż
+ * @p num, zbierając numery z drzew odwróconych przekierowań nowych węzłów.
+ * @param[in] to – wskaźnik na korzeń drzewa @p to;
+ * @param[in,out] path – wskaźnik na ścieżkę;
+ * @param[in] num – wskaźnik na numer;
+ * @param[in] common – długość wspólnego prefiksu @p num i poprzedniego numeru.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool moveBatchPath(Node *to, BatchPath *path, char const *num,
+                          size_t common) {
+    if (path->depth > common)
+        path->depth = common;
+    path->last = path->ends[path->depth];
+    Node *node = path->depth > 0 ? path->nodes[path->depth - 1] : to;
+    while (num[path->depth] != '\0' && node != NULL) {
+        size_t digit = digitFinder(num[path->depth]);
+        node = digit < node->width ? node->numbers[digit] : NULL;
+        if (node == NULL)
+            break;
+        if (!nodeForEach(node->backward, pushValue, path))
+            return false;
+        path->nodes[path->depth++] = node;
+        path->ends[path->depth] = path->last;
+    }
+    return true;
+}
+
+/** @brief Sortuje numery i usuwa powtórzenia.
+ * @param[in,out] phones – wskaźnik na strukturę przechowującą numery.
+ */
+static void phnumUnique(PhoneNumbers *phones) {
+    qsort(phones->numbers, phones->last, sizeof(Number *), compare);
+    size_t kept = 0;
+    for (size_t i = 0; i < phones->last; i++) {
+        if (kept > 0 && numberCompare(phones->numbers[kept - 1],
+                                      phones->numbers[i]) == 0)
+            free(phones->numbers[i]);
+        else
+            phones->numbers[kept++] = phones->numbers[i];
+    }
+    phones->last = kept;
+}
+
+/** @brief Wyznacza wynik zapytania odwrotnego z zebranej ścieżki.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] path – wskaźnik na ścieżkę zebraną dla @p num;
+ * @param[in] num – wskaźnik na numer;
+ * @param[in] get – czy wynik ma spełniać specyfikację funkcji
+ *                  @ref phfwdGetReverse zamiast @ref phfwdReverse.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci.
+ */
+static PhoneNumbers *batchResult(PhoneForward const *pf,
+                                 BatchPath const *path, char const *num,
+                                 bool get) {
+    PhoneNumbers *result = phnumNew();
+    bool ok = result != NULL;
+    for (size_t level = 1; ok && level <= path->depth; level++) {
+        char const *suffix = num + level;
+        for (size_t i = path->ends[level - 1]; ok && i < path->ends[level];
+             i++) {
+            Number *number = numberAppend(path->values[i], suffix);
+            if (number == NULL) {
+                ok = false;
+                break;
+            }
+            bool add = true;
+            if (get && suffix[0] != '\0')
+                add = forwardsTo(pf, number, num);
+            if (add)
+                ok = phnumPush(result, number);
+            if (!add || !ok)
+                free(number);
+        }
+    }
+    if (ok) {
+        Number *copy = numberNew(num, "");
+        ok = copy != NULL;
+        bool add = ok && (!get || forwardsTo(pf, copy, num));
+        if (add)
+            ok = phnumPush(result, copy);
+        if (!add || !ok)
+            free(copy);
+    }
+    if (!ok) {
+        phnumDelete(result);
+        return NULL;
+    }
+    phnumUnique(result);
+    return phnumFinish(result);
+}
+
+/** @brief Porównuje wskaźniki na numery funkcją @ref compareText.
+ * @param[in] val1 – wskaźnik na wskaźnik na pierwszy numer;
+ * @param[in] val2 – wskaźnik na wskaźnik na drugi numer.
+ * @return Wynik funkcji @ref compareText dla wskazywanych numerów.
+ */
+static int compareTargets(const void *val1, const void *val2) {
+    return compareText(*(char const *const *const *) val1,
+                       *(char const *const *const *) val2);
+}
+
+/** @brief Wyznacza wyniki zapytań odwrotnych dla wielu numerów.
+ * Sortuje numery i przechodzi drzewo @p to jeden raz, tak że numery
+ * przekierowane na wspólny prefiks kolejnych numerów są zbierane tylko raz.
+ * Dla zamrożonych drzew, w których listy te są gotowe, wywołuje zapytania
+ * kolejno.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] nums – tablica numerów;
+ * @param[in] count – liczba numerów;
+ * @param[in] get – czy wyniki mają spełniać specyfikację funkcji
+ *                  @ref phfwdGetReverse zamiast @ref phfwdReverse;
+ * @param[out] results – tablica na @p count wyników.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool reverseBatch(PhoneForward const *pf, char const *const *nums,
+                         size_t count, bool get, PhoneNumbers **results) {
+    if (pf == NULL || (count > 0 && (nums == NULL || results == NULL)))
+        return false;
+    for (size_t i = 0; i < count; i++)
+        results[i] = NULL;
+    char const *const **targets = malloc((count + 1) * sizeof *targets);
+    BatchPath path = {NULL, NULL, malloc(16 * sizeof(Number const *)), 16, 0,
+                      0};
+    bool ok = targets != NULL && path.values != NULL;
+    size_t valid = 0, longest = 0;
+    Frozen const *frozen = snapshot(pf);
+    if (ok && frozen == NULL)
+        ok = reverseReady(pf);
+    for (size_t i = 0; ok && i < count; i++) {
+        if (frozen != NULL) {
+            results[i] = get ? phfwdGetReverse(pf, nums[i])
+                             : phfwdReverse(pf, nums[i]);
+            ok = results[i] != NULL;
+        } else if (!isItNumber(nums[i])) {
+            results[i] = phnumFinish(phnumNew());
+            ok = results[i] != NULL;
+        } else {
+            targets[valid++] = &nums[i];
+            size_t length = strlen(nums[i]);
+            if (length > longest)
+                longest = length;
+        }
+    }
+    if (ok && valid > 0) {
+        path.nodes = malloc(longest * sizeof(Node *));
+        path.ends = malloc((longest + 1) * sizeof(size_t));
+        ok = path.nodes != NULL && path.ends != NULL;
+    }
+    if (ok && valid > 0) {
+        qsort(targets, valid, sizeof *targets, compareTargets);
+        path.ends[0] = 0;
+        char const *previous = "";
+        for (size_t i = 0; ok && i < valid; i++) {
+            char const *num = *targets[i];
+            size_t common = 0;
+            while (num[common] != '\0' && num[common] == previous[common])
+                common++;
+            ok = moveBatchPath(pf->to, &path, num, common);
+            if (ok) {
+                size_t index = (size_t) (targets[i] - nums);
+                results[index] = batchResult(pf, &path, num, get);
+                ok = results[index] != NULL;
+            }
+            previous = num;
+        }
+    }
+    multiFree(4, targets, path.nodes, path.ends, path.values);
+    if (!ok) {
+        for (size_t i = 0; i < count; i++) {
+            phnumDelete(results[i]);
+            results[i] = NULL;
+        }
+    }
+    return ok;
+}
+
+bool phfwdReverseBatch(PhoneForward const *pf, char const *const *nums,
+                       size_t count, PhoneNumbers **results) {
+    return reverseBatch(pf, nums, count, false, results);
+}
+
+bool phfwdGetReverseBatch(PhoneForward const *pf, char const *const *nums,
+                          size_t count, PhoneNumbers **results) {
+    return reverseBatch(pf, nums, count, true, results);
+}
+
+void phfwdCompact(PhoneForward *pf) {
+    if (pf != NULL) {
+        pf->from = nodeCompact(&pf->memory, pf->from);
+        pf->to = nodeCompact(&pf->memory, pf->to);
+        Node *roots[] = {pf->from, pf->to};
+        memoryTrim(&pf->memory, roots, 2);
+        if (pf->jump != NULL) {
+            // Kompaktowanie przenosi węzły, więc tablicę trzeba zbudować
+            // od nowa. Jeśli zabraknie pamięci, zostaje wyłączona.
+            size_t levels = jumpLevels(pf->jump);
+            jumpDelete(pf->jump);
+            pf->jump = jumpNew(pf->from, levels);
+        }
+#ifdef __GLIBC__
+        malloc_trim(0);
+#endif
+    }
+}
+
+bool phfwdSetJumpLevels(PhoneForward *pf, size_t levels) {
+    if (pf == NULL || pf->frozen != NULL || levels > JUMP_MAX_LEVELS)
+        return false;
+    JumpTable *jump = levels > 0 ? jumpNew(pf->from, levels) : NULL;
+    if (levels > 0 && jump == NULL)
+        return false;
+    jumpDelete(pf->jump);
+    pf->jump = jump;
+    return true;
+}
+
+bool phfwdSetLazyReverse(PhoneForward *pf, bool lazy, size_t idle) {
+    if (pf == NULL || pf->frozen != NULL)
+        return false;
+    // Porzucony indeks może mieć tylko struktura w trybie leniwym, więc
+    // reverseReady zbuduje go przed wyłączeniem tego trybu.
+    if (!lazy && !reverseReady(pf))
+        return false;
+    pf->lazyReverse = lazy;
+    pf->reverseIdle = lazy ? idle : 0;
+    pf->reverseChanges = 0;
+    if (lazy && !pf->reverseStale)
+        reverseDrop(pf);
+    return true;
+}
+
+bool phfwdPublish(PhoneForward *pf) {
+    if (pf == NULL || (pf->frozen == NULL && !reverseReady(pf)))
+        return false;
+    Frozen *frozen = pf->frozen != NULL ? pf->frozen
+                                        : frozenNew(pf->from, pf->to);
+    if (frozen == NULL)
+        return false;
+    Replicas *replicas = replicasNew(frozen);
+    if (frozen != pf->frozen)
+        frozenDelete(frozen);
+    if (replicas == NULL)
+        return false;
+    replicasDelete(pf->replicas);
+    pf->replicas = replicas;
+    return true;
+}
+
+size_t phfwdReplicas(PhoneForward const *pf) {
+    if (pf == NULL || pf->replicas == NULL)
+        return 0;
+    return replicasCount(pf->replicas);
+}
+
+/** @brief Tworzy nowy ciąg zmian.
+ * @return Wskaźnik na pusty ciąg zmian lub NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+static PhoneChanges *phchgNew(void) {
+    PhoneChanges *new = malloc(sizeof(PhoneChanges));
+    if (new == NULL)
+        return NULL;
+    new->from = NULL;
+    new->to = NULL;
+    new->size = 0;
+    new->last = 0;
+    return new;
+}
+
+/** @brief Dopisuje zmianę do ciągu.
+ * @param[in,out] changes – wskaźnik na ciąg zmian;
+ * @param[in] num1 – prefiks numerów, których dotyczy zmiana;
+ * @param[in] num2 – prefiks docelowy lub NULL, jeśli zmiana usuwa
+ *                   przekierowania.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool phchgAdd(PhoneChanges *changes, char const *num1,
+                     char const *num2) {
+    if (changes->last == changes->size) {
+        size_t size = changes->size == 0 ? 16 : 2 * changes->size;
+        char **from = realloc(changes->from, size * sizeof(char *));
+        if (from == NULL)
+            return false;
+        changes->from = from;
+        char **to = realloc(changes->to, size * sizeof(char *));
+        if (to == NULL)
+            return false;
+        changes->to = to;
+        changes->size = size;
+    }
+    char *from = copyString(num1);
+    char *to = num2 != NULL ? copyString(num2) : NULL;
+    if (from == NULL || (num2 != NULL && to == NULL)) {
+        multiFree(2, from, to);
+        return false;
+    }
+    changes->from[changes->last] = from;
+    changes->to[changes->last] = to;
+    changes->last++;
+    return true;
+}
+
+/** @brief Dopisuje do ciągu zmian dodanie przekierowania.
+ * @param[in] node – wskaźnik na węzeł z przekierowaniem;
+ * @param[in,out] data – wskaźnik na ciąg zmian.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool addChange(Node *node, void *data) {
+    char *num1 = numberText(node->mine);
+    char *num2 = numberText(node->value);
+    bool ok = num1 != NULL && num2 != NULL && phchgAdd(data, num1, num2);
+    multiFree(2, num1, num2);
+    return ok;
+}
+
+/** @brief Porównuje odpowiadające sobie węzły dwóch drzew.
+ * Dopisuje do ciągu zmian zmiany przekierowania węzła, a jeśli poddrzewo
+ * @p b nie ma już przekierowań, które mogłyby zostać w poddrzewie @p a,
+ * usuwa poddrzewo i dodaje wszystkie przekierowania z @p b.
+ * @param[in] a – wskaźnik na węzeł drzewa wyjściowego lub NULL;
+ * @param[in] b – wskaźnik na węzeł drzewa docelowego lub NULL;
+ * @param[in] path – numer reprezentowany przez węzły;
+ * @param[in,out] changes – wskaźnik na ciąg zmian;
+ * @param[out] ok – ustawiane na @p false, jeśli nie udało się alokować
+ *                  pamięci.
+ * @return Wartość @p true, jeśli trzeba porównać synów węzłów.
+ */
+static bool diffNode(Node *a, Node *b, char const *path,
+                     PhoneChanges *changes, bool *ok) {
+    if (a != NULL && b != NULL && a->hash == b->hash)
+        return false;
+    if (a == NULL) {
+        *ok = nodeForEach(b, addChange, changes);
+        return false;
+    }
+    if (b == NULL || (a->value != NULL && b->value == NULL)) {
+        if (a->hash != 0)
+            *ok = phchgAdd(changes, path, NULL);
+        if (*ok && b != NULL)
+            *ok = nodeForEach(b, addChange, changes);
+        return false;
+    }
+    if (b->value != NULL &&
+        (a->value == NULL || numberCompare(a->value, b->value) != 0))
+        *ok = addChange(b, changes);
+    return *ok;
+}
+
+/**
+ * To jest struktura reprezentująca parę odpowiadających sobie węzłów
+ * porównywanych drzew.
+ */
+typedef struct DiffFrame {
+    Node *a;     ///< węzeł drzewa wyjściowego lub NULL
+    Node *b;     ///< węzeł drzewa docelowego lub NULL
+    size_t next; ///< następna cyfra do porównania lub @ref DIGITS
+} DiffFrame;
+
+/** @brief Zwraca syna węzła.
+ * @param[in] node – wskaźnik na węzeł lub NULL;
+ * @param[in] digit – cyfra syna.
+ * @return Wskaźnik na syna lub NULL, jeśli go nie ma.
+ */
+static inline Node *childOf(Node *node, size_t digit) {
+    return node != NULL && digit < node->width ? node->numbers[digit] : NULL;
+}
+
+/** @brief Porównuje dwa drzewa przekierowań.
+ * Przechodzi w głąb równocześnie oba drzewa i dopisuje do ciągu zmian
+ * zmiany zamieniające przekierowania z @p a na przekierowania z @p b.
+ * @param[in] a – wskaźnik na korzeń drzewa wyjściowego;
+ * @param[in] b – wskaźnik na korzeń drzewa docelowego;
+ * @param[in,out] changes – wskaźnik na ciąg zmian.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool diffTrees(Node *a, Node *b, PhoneChanges *changes) {
+    DiffFrame *frames = malloc(sizeof(DiffFrame));
+    char *path = malloc(1);
+    size_t size = 1, depth = 0;
+    bool ok = frames != NULL && path != NULL;
+    if (ok) {
+        path[0] = '\0';
+        frames[0] = (DiffFrame) {a, b, diffNode(a, b, path, changes, &ok)
+                                       ? 0 : DIGITS};
+    }
+    while (ok) {
+        DiffFrame *frame = &frames[depth];
+        while (frame->next < DIGITS && childOf(frame->a, frame->next) == NULL &&
+               childOf(frame->b, frame->next) == NULL)
+            frame->next++;
+        if (frame->next == DIGITS) {
+            if (depth == 0)
+                break;
+            depth--;
+            continue;
+        }
+        size_t digit = frame->next++;
+        if (depth + 2 > size) {
+            DiffFrame *new_frames = realloc(frames,
+                                            2 * size * sizeof(DiffFrame));
+            char *new_path = new_frames != NULL ? realloc(path, 2 * size)
+                                                : NULL;
+            if (new_frames != NULL)
+                frames = new_frames;
+            if (new_path == NULL) {
+                ok = false;
+                break;
+            }
+            path = new_path;
+            size *= 2;
+            frame = &frames[depth];
+        }
+        Node *childA = childOf(frame->a, digit);
+        Node *childB = childOf(frame->b, digit);
+        path[depth] = digitChar(digit);
+        path[depth + 1] = '\0';
+        depth++;
+        frames[depth] = (DiffFrame) {childA, childB,
+                                     diffNode(childA, childB, path, changes,
+                                              &ok) ? 0 : DIGITS};
+    }
+    multiFree(2, frames, path);
+    return ok;
+}
+
+PhoneChanges *phfwdDiff(PhoneForward const *a, PhoneForward const *b) {
+    if (a == NULL || b == NULL || a->frozen != NULL || b->frozen != NULL)
+        return NULL;
+    PhoneChanges *changes = phchgNew();
+    if (changes != NULL && !diffTrees(a->from, b->from, changes)) {
+        phchgDelete(changes);
+        changes = NULL;
+    }
+    return changes;
+}
+
+bool phfwdApply(PhoneForward *pf, PhoneChanges const *changes) {
+    if (pf == NULL || changes == NULL)
+        return false;
+    for (size_t i = 0; i < changes->last; i++) {
+        if (changes->to[i] == NULL)
+            phfwdRemove(pf, changes->from[i]);
+        else if (!phfwdAdd(pf, changes->from[i], changes->to[i]))
+            return false;
+    }
+    return true;
+}
+
+size_t phchgSize(PhoneChanges const *changes) {
+    return changes != NULL ? changes->last : 0;
+}
+
+bool phchgGet(PhoneChanges const *changes, size_t idx, char const **num1,
+              char const **num2) {
+    if (changes == NULL || idx >= changes->last)
+        return false;
+    *num1 = changes->from[idx];
+    *num2 = changes->to[idx];
+    return true;
+}
+
+void phchgDelete(PhoneChanges *changes) {
+    if (changes != NULL) {
+        for (size_t i = 0; i < changes->last; i++)
+            multiFree(2, changes->from[i], changes->to[i]);
+        multiFree(3, changes->from, changes->to, changes);
+    }
+}
+
+bool phfwdFeedOpen(PhoneForward *pf, size_t capacity) {
+    if (pf == NULL || pf->feed != NULL || capacity == 0)
+        return false;
+    pf->feed = feedNew(capacity);
+    return pf->feed != NULL;
+}
+
+uint64_t phfwdFeedFirst(PhoneForward const *pf) {
+    return pf != NULL && pf->feed != NULL ? feedFirst(pf->feed) : 0;
+}
+
+uint64_t phfwdFeedNext(PhoneForward const *pf) {
+    return pf != NULL && pf->feed != NULL ? feedNext(pf->feed) : 0;
+}
+
+PhoneChanges *phfwdFeedRead(PhoneForward const *pf, uint64_t *sequence,
+                            size_t max) {
+    if (pf == NULL || pf->feed == NULL || sequence == NULL ||
+        *sequence < feedFirst(pf->feed) || *sequence > feedNext(pf->feed))
+        return NULL;
+    PhoneChanges *changes = phchgNew();
+    uint64_t next = *sequence;
+    while (changes != NULL && next < feedNext(pf->feed) &&
+           changes->last < max) {
+        char const *num1, *num2;
+        feedGet(pf->feed, next, &num1, &num2);
+        if (!phchgAdd(changes, num1, num2)) {
+            phchgDelete(changes);
             return NULL;
         }
+        next++;
     }
-    phnumDelete(pnum);
-    if (result != NULL)
-        qsort(result->numbers, result->last, sizeof(char *),
-              compare);
+    if (changes != NULL)
+        *sequence = next;
+    return changes;
+}
+
+bool phchgWrite(PhoneChanges const *changes, FILE *file) {
+    if (changes == NULL || file == NULL)
+        return false;
+    for (size_t i = 0; i < changes->last; i++) {
+        int written = changes->to[i] != NULL
+                      ? fprintf(file, "+ %s %s\n", changes->from[i],
+                                changes->to[i])
+                      : fprintf(file, "- %s\n", changes->from[i]);
+        if (written < 0)
+            return false;
+    }
+    return fflush(file) == 0;
+}
 
-    return result;
-}
\ No newline at end of file
+PhoneChanges *phchgRead(FILE *file, size_t max) {
+    if (file == NULL)
+        return NULL;
+    PhoneChanges *changes = phchgNew();
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    bool ok = changes != NULL;
+    while (ok && changes->last < max &&
+           (length = getline(&line, &size, file)) > 0) {
+        if (line[length - 1] != '\n')
+            break;
+        line[length - 1] = '\0';
+        char *num2 = line[0] == '+' ? strchr(line + 2, ' ') : NULL;
+        if (num2 != NULL)
+            num2[0] = '\0';
+        if ((line[0] != '+' && line[0] != '-') || line[1] != ' ' ||
+            !isItNumber(line + 2) ||
+            (line[0] == '+' && (num2 == NULL || !isItNumber(num2 + 1))))
+            ok = false;
+        else
+            ok = phchgAdd(changes, line + 2, num2 != NULL ? num2 + 1 : NULL);
+    }
+    if (ok && ferror(file))
+        ok = false;
+    free(line);
+    if (!ok) {
+        phchgDelete(changes);
+        return NULL;
+    }
+    return changes;
+}
+
+bool phfwdFreeze(PhoneForward *pf) {
+    if (pf == NULL)
+        return false;
+    if (pf->frozen != NULL)
+        return true;
+    if (!reverseReady(pf))
+        return false;
+    pf->frozen = frozenNew(pf->from, pf->to);
+    if (pf->frozen == NULL)
+        return false;
+    completeDelete(&pf->memory, pf->from);
+    completeDelete(&pf->memory, pf->to);
+    memoryTrim(&pf->memory, NULL, 0);
+    jumpDelete(pf->jump);
+    pf->jump = NULL;
+    pf->from = NULL;
+    pf->to = NULL;
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    return true;
+}
+
+/** @brief Zapisuje przekierowanie do pliku.
+ * Dopisuje do pliku przekazanego w @p data wiersz z przekierowaniem
+ * przechowywanym w węźle @p node.
+ * @param[in] node – wskaźnik na węzeł z przekierowaniem;
+ * @param[in] data – wskaźnik na plik typu FILE.
+ * @return Wartość @p true, jeśli zapis się powiódł.
+ */
+static bool saveForward(Node *node, void *data) {
+    return numberPrint(node->mine, data) && putc(' ', data) != EOF &&
+           numberPrint(node->value, data) && putc('\n', data) != EOF;
+}
+
+/** @brief Zapisuje przekierowanie zamrożonej struktury do pliku.
+ * Odpowiednik funkcji @ref saveForward dla zamrożonej struktury.
+ * @param[in] num1 – prefiks numerów przekierowywanych;
+ * @param[in] num2 – prefiks numerów, na które jest wykonywane przekierowanie;
+ * @param[in] data – wskaźnik na plik typu FILE.
+ * @return Wartość @p true, jeśli zapis się powiódł.
+ */
+static bool saveFrozenForward(char const *num1, char const *num2, void *data) {
+    return fputs(num1, data) >= 0 && putc(' ', data) != EOF &&
+           fputs(num2, data) >= 0 && putc('\n', data) != EOF;
+}
+
+bool phfwdSave(PhoneForward const *pf, char const *path) {
+    if (pf == NULL || path == NULL)
+        return false;
+    char *tmp = malloc(strlen(path) + 5);
+    if (tmp == NULL)
+        return false;
+    strcpy(tmp, path);
+    strcat(tmp, ".tmp");
+    FILE *file = fopen(tmp, "w");
+    if (file == NULL) {
+        free(tmp);
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, SAVE_BUFFER);
+    bool ok = (pf->frozen != NULL
+               ? frozenForEachForward(pf->frozen, saveFrozenForward, file)
+               : nodeForEach(pf->from, saveForward, file)) &&
+              fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0)
+        ok = false;
+    // Dziennik może być skrócony dopiero, gdy nowy wpis katalogu jest
+    // utrwalony, inaczej po awarii zostałby stary zrzut i krótki dziennik.
+    if (ok)
+        ok = rename(tmp, path) == 0 && journalSyncDirectory(path);
+    else
+        remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+/** @brief Wczytuje przekierowania z pliku.
+ * Dodaje do struktury @p pf przekierowania zapisane w otwartym pliku @p file
+ * w formacie funkcji @ref phfwdSave.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] file – wskaźnik na plik otwarty do odczytu.
+ * @return Wartość @p true, jeśli wczytano cały plik.
+ */
+static bool loadForwards(PhoneForward *pf, FILE *file) {
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    bool ok = true;
+    while (ok && (length = getline(&line, &size, file)) > 0) {
+        if (line[length - 1] == '\n')
+            line[length - 1] = '\0';
+        char *num2 = strchr(line, ' ');
+        if (num2 == NULL) {
+            ok = false;
+        } else {
+            num2[0] = '\0';
+            ok = phfwdAdd(pf, line, num2 + 1);
+        }
+    }
+    if (ferror(file))
+        ok = false;
+    free(line);
+    return ok;
+}
+
+PhoneForward *phfwdLoad(char const *path) {
+    if (path == NULL)
+        return NULL;
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return NULL;
+    PhoneForward *pf = phfwdNew();
+    if (pf != NULL && !loadForwards(pf, file)) {
+        phfwdDelete(pf);
+        pf = NULL;
+    }
+    fclose(file);
+    return pf;
+}
+
+bool phfwdJournalOpen(PhoneForward *pf, char const *path, size_t batch) {
+    if (pf == NULL || path == NULL || pf->journal != NULL)
+        return false;
+    pf->journal = journalOpen(path, batch);
+    return pf->journal != NULL;
+}
+
+bool phfwdJournalSync(PhoneForward *pf) {
+    if (pf == NULL || pf->journal == NULL)
+        return true;
+    phfwdCheckpointFinish(pf, false);
+    return journalSync(pf->journal);
+}
+
+/** @brief Odtwarza dodanie przekierowania z dziennika.
+ * @param[in,out] data – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num1 – prefiks numerów przekierowywanych;
+ * @param[in] num2 – prefiks numerów, na które jest wykonywane przekierowanie.
+ * @return Wynik funkcji @ref phfwdAdd.
+ */
+static bool replayAdd(void *data, char const *num1, char const *num2) {
+    return phfwdAdd(data, num1, num2);
+}
+
+/** @brief Odtwarza usunięcie przekierowań z dziennika.
+ * @param[in,out] data – wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] num – prefiks numerów, których przekierowania są usuwane.
+ */
+static void replayRemove(void *data, char const *num) {
+    phfwdRemove(data, num);
+}
+
+PhoneForward *phfwdRecover(char const *snapshot, char const *journal,
+                           size_t batch) {
+    if (snapshot == NULL || journal == NULL)
+        return NULL;
+    PhoneForward *pf;
+    if (access(snapshot, F_OK) == 0)
+        pf = phfwdLoad(snapshot);
+    else
+        pf = phfwdNew();
+    if (pf == NULL)
+        return NULL;
+    // Każda operacja ustala stan tylko tych numerów, których dotyczy, więc
+    // odtworzenie operacji już zawartych w migawce nie zmienia wyniku.
+    long end;
+    if (!journalReplay(journal, replayAdd, replayRemove, pf, &end) ||
+        (end >= 0 && truncate(journal, end) != 0) ||
+        !phfwdJournalOpen(pf, journal, batch)) {
+        phfwdDelete(pf);
+        return NULL;
+    }
+    return pf;
+}
+
+bool phfwdCheckpoint(PhoneForward *pf, char const *snapshot) {
+    if (pf == NULL || snapshot == NULL || pf->journal == NULL ||
+        !phfwdCheckpointFinish(pf, false))
+        return false;
+    long offset = journalOffset(pf->journal);
+    if (offset < 0)
+        return false;
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0)
+        _exit(phfwdSave(pf, snapshot) ? EXIT_SUCCESS : EXIT_FAILURE);
+    pf->checkpoint = pid;
+    pf->checkpointOffset = offset;
+    return true;
+}
+
+bool phfwdCheckpointFinish(PhoneForward *pf, bool wait) {
+    if (pf == NULL || pf->checkpoint == 0)
+        return true;
+    int status;
+    pid_t pid = waitpid(pf->checkpoint, &status, wait ? 0 : WNOHANG);
+    if (pid == 0)
+        return false;
+    pf->checkpoint = 0;
+    if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS)
+        journalTruncate(pf->journal, pf->checkpointOffset);
+    return true;
+}
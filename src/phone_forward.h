@@ -11,6 +11,8 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "tree.h"
 
 /**
@@ -23,6 +25,30 @@ typedef struct PhoneForward PhoneForward;
  */
 typedef struct PhoneNumbers PhoneNumbers;
 
+/**
+ * To jest struktura przechowująca ciąg zmian przekierowań.
+ */
+typedef struct PhoneChanges PhoneChanges;
+
+/**
+ * To jest struktura opisująca filtr wyniku zapytań odwrotnych. Pola
+ * o wartości NULL lub 0 nie ograniczają wyniku.
+ */
+typedef struct PhoneFilter {
+    char const *lo;     ///< najmniejszy numer, który może należeć do wyniku
+    char const *hi;     ///< najmniejszy numer większy od numerów wyniku
+    char const *prefix; ///< prefiks wszystkich numerów wyniku
+    size_t limit;       ///< maksymalna liczba numerów wyniku
+} PhoneFilter;
+
+/**
+ * To jest typ opisujący alfabet numerów, dla którego tworzona jest struktura.
+ */
+typedef enum PhoneAlphabet {
+    PHONE_ALPHABET_FULL,    ///< cyfry od 0 do 9 oraz * i #
+    PHONE_ALPHABET_DECIMAL  ///< tylko cyfry od 0 do 9
+} PhoneAlphabet;
+
 /** @brief Tworzy nową strukturę.
  * Tworzy nową strukturę niezawierającą żadnych przekierowań.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
@@ -30,6 +56,85 @@ typedef struct PhoneNumbers PhoneNumbers;
  */
 PhoneForward *phfwdNew(void);
 
+/** @brief Tworzy nową strukturę dla numerów dziesiętnych.
+ * Tworzy nową strukturę niezawierającą żadnych przekierowań, która
+ * przechowuje tylko numery złożone z cyfr od 0 do 9. Jej węzły nie mają
+ * miejsca na cyfry * i #, więc zajmują mniej pamięci. Funkcja @ref phfwdAdd
+ * odrzuca numery zawierające te cyfry, a zapytania o takie numery działają
+ * tak, jakby nie było dla nich przekierowań. Równoważne wywołaniu
+ * @ref phfwdNewWithAllocator(PHONE_ALPHABET_DECIMAL, NULL, 0).
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+PhoneForward *phfwdNewDecimal(void);
+
+/** @brief Buduje strukturę z wielu przekierowań naraz.
+ * Tworzy strukturę, która zawiera te same przekierowania, co struktura
+ * utworzona funkcją @ref phfwdNew po kolejnych wywołaniach
+ * @ref phfwdAdd(pf, num1s[i], num2s[i]) dla i od 0 do @p count - 1:
+ * niepoprawne przekierowania są pomijane, a z powtórzonego numeru wygrywa
+ * ostatnie. Przekierowania są dzielone według dwóch pierwszych cyfr numerów
+ * na części, które są budowane równolegle w @p threads wątkach.
+ * @param[in] num1s – tablica @p count numerów przekierowywanych;
+ * @param[in] num2s – tablica @p count numerów docelowych;
+ * @param[in] count – liczba przekierowań;
+ * @param[in] threads – liczba wątków lub 0, aby użyć wszystkich procesorów.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci albo @p num1s lub @p num2s wynosi NULL.
+ */
+PhoneForward *phfwdBuild(char const *const *num1s, char const *const *num2s,
+                         size_t count, size_t threads);
+
+/**
+ * To jest struktura przechowująca funkcje, którymi struktura przekierowań
+ * przydziela i zwalnia pamięć na węzły i napisy swoich drzew.
+ */
+typedef struct PhoneAllocator {
+    /** Funkcja przydzielająca @p size bajtów lub zwracająca NULL. */
+    void *(*allocate)(size_t size, void *data);
+    /** Funkcja zwalniająca @p size bajtów przydzielonych pod adresem @p ptr. */
+    void (*release)(void *ptr, size_t size, void *data);
+    void *data; ///< argument przekazywany obu funkcjom
+} PhoneAllocator;
+
+/** @brief Tworzy nową strukturę z własnym źródłem pamięci.
+ * Tworzy nową strukturę niezawierającą żadnych przekierowań, która
+ * przydziela pamięć na siebie, węzły i napisy drzew funkcjami @p allocator
+ * i zajmuje jej co najwyżej @p budget bajtów. Funkcja @ref phfwdAdd zwraca
+ * @p false, nie zmieniając struktury, jeśli dodanie przekierowania
+ * przekroczyłoby limit. Wyniki zapytań, zamrożone drzewa, tablica skoków
+ * i strumień zmian są alokowane funkcją malloc i nie wliczają się do limitu.
+ * Struktura z własnymi funkcjami przydziału nie jest kompaktowana przez
+ * @ref phfwdCompact. Alfabet struktury jest wybierany raz, przy jej
+ * utworzeniu; dla alfabetu dziesiętnego struktura zachowuje się tak, jak
+ * utworzona funkcją @ref phfwdNewDecimal.
+ * @param[in] alphabet – alfabet numerów struktury;
+ * @param[in] allocator – wskaźnik na funkcje przydziału pamięci lub NULL dla
+ *                        funkcji malloc i free;
+ * @param[in] budget – limit pamięci w bajtach lub 0, jeśli limitu nie ma.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci, limit jest za mały na pustą strukturę,
+ *         któraś z funkcji @p allocator wynosi NULL lub @p alphabet nie jest
+ *         poprawnym alfabetem.
+ */
+PhoneForward *phfwdNewWithAllocator(PhoneAlphabet alphabet,
+                                    PhoneAllocator const *allocator,
+                                    size_t budget);
+
+/** @brief Podaje ilość pamięci zajmowanej przez strukturę.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Liczba bajtów przydzielonych na strukturę, jej węzły i napisy lub
+ *         0, jeśli @p pf wynosi NULL.
+ */
+size_t phfwdMemoryLive(PhoneForward const *pf);
+
+/** @brief Podaje największą ilość pamięci zajmowaną przez strukturę.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Największa dotychczasowa wartość @ref phfwdMemoryLive lub 0, jeśli
+ *         @p pf wynosi NULL.
+ */
+size_t phfwdMemoryPeak(PhoneForward const *pf);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pf. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
@@ -51,8 +156,11 @@ void phfwdDelete(PhoneForward *pf);
  *                     na które jest wykonywane przekierowanie.
  * @return Wartość @p true, jeśli przekierowanie zostało dodane.
  *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
- *         reprezentuje numeru, oba podane numery są identyczne, nie udało
- *         się alokować pamięci lub @p pf wynosi NULL.
+ *         reprezentuje numeru, oba podane numery są identyczne, numer
+ *         zawiera cyfrę spoza alfabetu struktury, nie udało się alokować
+ *         pamięci lub @p pf wynosi NULL. Wartość @p false jest też
+ *         zwracana, gdy przekierowanie zostało dodane, ale nie udało się
+ *         go zapisać w dzienniku operacji.
  */
 bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2);
 
@@ -96,6 +204,22 @@ PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num);
  */
 PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przefiltrowane przekierowania na dany numer.
+ * Wyznacza te numery z wyniku @ref phfwdReverse, które należą do przedziału
+ * [@p filter->lo, @p filter->hi) w porządku leksykograficznym i mają prefiks
+ * @p filter->prefix, a spośród nich co najwyżej @p filter->limit
+ * najmniejszych. Filtr jest sprawdzany już podczas przechodzenia drzew,
+ * więc poddrzewa, w których nie ma pasujących numerów, nie są odwiedzane.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer;
+ * @param[in] filter – wskaźnik na filtr wyniku.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci, @p pf lub @p filter wynosi NULL lub
+ *         któreś z pól @p lo, @p hi i @p prefix filtru nie jest numerem.
+ */
+PhoneNumbers *phfwdReverseFiltered(PhoneForward const *pf, char const *num,
+                                   PhoneFilter const *filter);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pnum. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
@@ -127,4 +251,357 @@ char const *phnumGet(PhoneNumbers const *pnum, size_t idx);
  */
 PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przefiltrowany wynik funkcji @ref phfwdGetReverse.
+ * Filtruje wynik tak jak funkcja @ref phfwdReverseFiltered.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer;
+ * @param[in] filter – wskaźnik na filtr wyniku.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci, @p pf lub @p filter wynosi NULL lub
+ *         któreś z pól @p lo, @p hi i @p prefix filtru nie jest numerem.
+ */
+PhoneNumbers *phfwdGetReverseFiltered(PhoneForward const *pf, char const *num,
+                                      PhoneFilter const *filter);
+
+/** @brief Wyznacza przekierowania na wiele numerów naraz.
+ * Dla każdego numeru @p nums[i] zapisuje w @p results[i] wynik funkcji
+ * @ref phfwdReverse. Numery są sortowane, a drzewo odwróconych przekierowań
+ * jest przechodzone raz, więc przekierowania na wspólne prefiksy numerów są
+ * wyszukiwane tylko raz dla całej grupy.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums – tablica @p count wskaźników na numery;
+ * @param[in] count – liczba numerów;
+ * @param[out] results – tablica na @p count wyników, które należy usunąć
+ *                       funkcją @ref phnumDelete.
+ * @return Wartość @p true, jeśli się udało, lub @p false, gdy nie udało się
+ *         alokować pamięci albo @p pf wynosi NULL; wtedy @p results nie
+ *         zawiera wyników.
+ */
+bool phfwdReverseBatch(PhoneForward const *pf, char const *const *nums,
+                       size_t count, PhoneNumbers **results);
+
+/** @brief Wyznacza wyniki funkcji @ref phfwdGetReverse dla wielu numerów.
+ * Działa tak jak funkcja @ref phfwdReverseBatch.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums – tablica @p count wskaźników na numery;
+ * @param[in] count – liczba numerów;
+ * @param[out] results – tablica na @p count wyników, które należy usunąć
+ *                       funkcją @ref phnumDelete.
+ * @return Wartość @p true, jeśli się udało, lub @p false, gdy nie udało się
+ *         alokować pamięci albo @p pf wynosi NULL; wtedy @p results nie
+ *         zawiera wyników.
+ */
+bool phfwdGetReverseBatch(PhoneForward const *pf, char const *const *nums,
+                          size_t count, PhoneNumbers **results);
+
+/** @brief Kompaktuje strukturę.
+ * Przenosi węzły drzew przechowujących przekierowania do ciągłych obszarów
+ * pamięci, w kolejności sprzyjającej wyszukiwaniu, i oddaje systemowi
+ * zwolnioną w ten sposób pamięć. Przydatne po wielu dodaniach i usunięciach
+ * przekierowań, po których węzły są rozrzucone po stercie. Jeśli zabraknie
+ * pamięci, część węzłów pozostaje na swoich miejscach. Nic nie robi, jeśli
+ * @p pf wynosi NULL.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ */
+void phfwdCompact(PhoneForward *pf);
+
+/** @brief Ustawia liczbę poziomów tablicy skoków.
+ * Tablica skoków ma po jednej pozycji dla każdego ciągu @p levels pierwszych
+ * cyfr numeru i pozwala funkcji @ref phfwdGet pominąć przechodzenie górnych,
+ * najgęściej odwiedzanych poziomów drzewa przekierowań. Zajmuje pamięć
+ * proporcjonalną do liczby cyfr alfabetu podniesionej do potęgi @p levels
+ * i jest aktualizowana przez @ref phfwdAdd i @ref phfwdRemove.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] levels – liczba poziomów, od 1 do 5, lub 0, aby wyłączyć
+ *                     tablicę.
+ * @return Wartość @p true, jeśli ustawiono tablicę.
+ *         Wartość @p false, jeśli @p levels jest za duże, struktura jest
+ *         zamrożona, nie udało się alokować pamięci lub @p pf wynosi NULL.
+ */
+bool phfwdSetJumpLevels(PhoneForward *pf, size_t levels);
+
+/** @brief Ustawia leniwe utrzymywanie indeksu odwrotnego.
+ * Indeks odwrotny to drzewo numerów docelowych wraz z numerami na nie
+ * przekierowanymi, z którego korzystają @ref phfwdReverse,
+ * @ref phfwdGetReverse oraz ich odmiany filtrowane i wsadowe. W trybie
+ * leniwym włączenie porzuca indeks, a @ref phfwdAdd i @ref phfwdRemove go
+ * nie aktualizują, dopóki pierwsze zapytanie odwrotne, zamrożenie lub
+ * publikacja nie zbuduje go od nowa z drzewa przekierowań. Zbudowany indeks
+ * jest aktualizowany przy zmianach, a jeśli @p idle jest dodatnie
+ * i kolejne @p idle zmian nastąpi bez zapytania odwrotnego, jest ponownie
+ * porzucany. Zapytania odwrotne budują porzucony indeks pod blokadą
+ * struktury, więc również w trybie leniwym można je wykonywać równolegle
+ * z innymi zapytaniami, ale nie ze zmianami przekierowań.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] lazy – czy utrzymywać indeks leniwie; wyłączenie trybu
+ *                   leniwego od razu buduje indeks;
+ * @param[in] idle – liczba zmian bez zapytań odwrotnych, po której indeks
+ *                   jest porzucany, lub 0.
+ * @return Wartość @p true, jeśli ustawiono tryb.
+ *         Wartość @p false, jeśli struktura jest zamrożona, nie udało się
+ *         alokować pamięci na indeks lub @p pf wynosi NULL.
+ */
+bool phfwdSetLazyReverse(PhoneForward *pf, bool lazy, size_t idle);
+
+/** @brief Publikuje migawkę do odczytu.
+ * Tworzy zamrożoną kopię przekierowań (zob. @ref phfwdFreeze) w pamięci
+ * każdego węzła NUMA, na dużych stronach, jeśli system na to pozwala.
+ * Dopóki migawka jest aktualna, funkcje @ref phfwdGet, @ref phfwdReverse
+ * i @ref phfwdGetReverse odpowiadają z kopii leżącej najbliżej procesora
+ * wywołującego wątku. Struktura pozostaje modyfikowalna: @ref phfwdAdd
+ * i @ref phfwdRemove wycofują migawkę, a zapytania wracają do drzew aż do
+ * kolejnego wywołania tej funkcji, które zastępuje poprzednią migawkę.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli migawka została opublikowana.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci (poprzednia
+ *         migawka pozostaje wtedy bez zmian) lub @p pf wynosi NULL.
+ */
+bool phfwdPublish(PhoneForward *pf);
+
+/** @brief Podaje liczbę kopii opublikowanej migawki.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                 numerów.
+ * @return Liczba kopii migawki lub 0, jeśli migawka nie jest opublikowana
+ *         lub @p pf wynosi NULL.
+ */
+size_t phfwdReplicas(PhoneForward const *pf);
+
+/** @brief Wyznacza różnicę między strukturami.
+ * Wyznacza ciąg zmian, który zastosowany funkcją @ref phfwdApply do
+ * struktury o przekierowaniach takich jak w @p a daje przekierowania takie
+ * jak w @p b. Zmiana jest dodaniem przekierowania albo usunięciem
+ * wszystkich przekierowań o danym prefiksie, tak jak w @ref phfwdRemove.
+ * Drzewa obu struktur są przechodzone równocześnie, a poddrzewa o równych
+ * skrótach przekierowań są pomijane, więc czas działania zależy od liczby
+ * różnic, a nie od liczby przekierowań. Skrót poddrzewa jest 64-bitową sumą
+ * skrótów jego przekierowań i nie jest porównywany z treścią poddrzewa, więc
+ * różne poddrzewa o przypadkiem równych skrótach są uznawane za równe,
+ * a różnice w nich są bez ostrzeżenia pomijane. Dla niezależnych danych
+ * zdarza się to z prawdopodobieństwem rzędu 2^-64 dla każdej porównanej pary
+ * poddrzew, ale skróty nie są kryptograficzne, więc dobrane celowo dane mogą
+ * taką kolizję wywołać. Gdy wymagana jest pewność, wynik trzeba sprawdzić,
+ * na przykład porównując zapytania obu struktur.
+ * @param[in] a – wskaźnik na strukturę wyjściową;
+ * @param[in] b – wskaźnik na strukturę docelową.
+ * @return Wskaźnik na strukturę przechowującą ciąg zmian lub NULL, gdy nie
+ *         udało się alokować pamięci, któraś ze struktur jest zamrożona lub
+ *         wynosi NULL.
+ */
+PhoneChanges *phfwdDiff(PhoneForward const *a, PhoneForward const *b);
+
+/** @brief Stosuje ciąg zmian.
+ * Wykonuje po kolei zmiany z ciągu @p changes funkcjami @ref phfwdAdd
+ * i @ref phfwdRemove.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] changes – wskaźnik na ciąg zmian.
+ * @return Wartość @p true, jeśli wykonano wszystkie zmiany.
+ *         Wartość @p false, jeśli dodanie przekierowania się nie powiodło
+ *         (kolejne zmiany nie są wtedy wykonywane) lub któryś ze wskaźników
+ *         wynosi NULL.
+ */
+bool phfwdApply(PhoneForward *pf, PhoneChanges const *changes);
+
+/** @brief Podaje liczbę zmian.
+ * @param[in] changes – wskaźnik na ciąg zmian.
+ * @return Liczba zmian w ciągu lub 0, jeśli @p changes wynosi NULL.
+ */
+size_t phchgSize(PhoneChanges const *changes);
+
+/** @brief Udostępnia zmianę.
+ * Zmiany są indeksowane kolejno od zera.
+ * @param[in] changes – wskaźnik na ciąg zmian;
+ * @param[in] idx – indeks zmiany;
+ * @param[out] num1 – wskaźnik na napis z prefiksem numerów, których dotyczy
+ *                    zmiana;
+ * @param[out] num2 – wskaźnik na napis z prefiksem numerów, na które
+ *                    przekierowanie jest dodawane, lub NULL, jeśli zmiana
+ *                    usuwa przekierowania.
+ * @return Wartość @p true, jeśli zmiana istnieje. Wartość @p false, jeśli
+ *         @p changes wynosi NULL lub indeks ma za dużą wartość.
+ */
+bool phchgGet(PhoneChanges const *changes, size_t idx, char const **num1,
+              char const **num2);
+
+/** @brief Usuwa ciąg zmian.
+ * Nic nie robi, jeśli @p changes ma wartość NULL.
+ * @param[in] changes – wskaźnik na usuwaną strukturę.
+ */
+void phchgDelete(PhoneChanges *changes);
+
+/** @brief Włącza strumień zmian.
+ * Od tej chwili każda zmiana przekierowań jest zapisywana w buforze
+ * cyklicznym o pojemności @p capacity zmian i otrzymuje kolejny numer
+ * sekwencyjny. Dodanie przekierowania, które już istnieje, nie jest zmianą.
+ * Wywołanie @ref phfwdRemove zapisuje usunięcie każdego usuniętego
+ * przekierowania osobno, w porządku leksykograficznym. Zmiany odczytuje się
+ * funkcją @ref phfwdFeedRead i stosuje do innej struktury funkcją
+ * @ref phfwdApply.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] capacity – liczba pamiętanych zmian.
+ * @return Wartość @p true, jeśli strumień został włączony.
+ *         Wartość @p false, jeśli był już włączony, @p capacity wynosi 0,
+ *         nie udało się alokować pamięci lub @p pf wynosi NULL.
+ */
+bool phfwdFeedOpen(PhoneForward *pf, size_t capacity);
+
+/** @brief Podaje numer najstarszej pamiętanej zmiany.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                 numerów.
+ * @return Numer sekwencyjny najstarszej zmiany, którą można odczytać, lub 0,
+ *         jeśli strumień jest wyłączony.
+ */
+uint64_t phfwdFeedFirst(PhoneForward const *pf);
+
+/** @brief Podaje numer następnej zmiany.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                 numerów.
+ * @return Numer sekwencyjny, który otrzyma następna zmiana, lub 0, jeśli
+ *         strumień jest wyłączony.
+ */
+uint64_t phfwdFeedNext(PhoneForward const *pf);
+
+/** @brief Odczytuje zmiany ze strumienia.
+ * Odczytuje co najwyżej @p max zmian, począwszy od zmiany o numerze
+ * @p *sequence, i przesuwa @p *sequence za ostatnią odczytaną zmianę.
+ * Jeśli zmiana o numerze @p *sequence została już zastąpiona nowszymi,
+ * odbiorca musi pobrać całą strukturę, np. funkcją @ref phfwdSave.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                 numerów;
+ * @param[in,out] sequence – wskaźnik na numer pierwszej odczytywanej zmiany;
+ * @param[in] max – maksymalna liczba odczytywanych zmian.
+ * @return Wskaźnik na ciąg zmian lub NULL, gdy zmiana @p *sequence nie jest
+ *         już pamiętana, strumień jest wyłączony, nie udało się alokować
+ *         pamięci lub któryś ze wskaźników wynosi NULL.
+ */
+PhoneChanges *phfwdFeedRead(PhoneForward const *pf, uint64_t *sequence,
+                            size_t max);
+
+/** @brief Zapisuje ciąg zmian do pliku.
+ * Zapisuje zmiany w formacie dziennika: wiersz "+ num1 num2" dla dodania
+ * i "- num" dla usunięcia, po czym opróżnia bufor pliku, więc nadaje się do
+ * przesyłania zmian potokiem lub gniazdem.
+ * @param[in] changes – wskaźnik na ciąg zmian;
+ * @param[in] file – wskaźnik na plik otwarty do zapisu.
+ * @return Wartość @p true, jeśli zapis się powiódł.
+ */
+bool phchgWrite(PhoneChanges const *changes, FILE *file);
+
+/** @brief Wczytuje ciąg zmian z pliku.
+ * Wczytuje co najwyżej @p max zmian zapisanych funkcją @ref phchgWrite, albo
+ * mniej, jeśli wcześniej skończy się plik. Niekompletny ostatni wiersz jest
+ * pomijany.
+ * @param[in] file – wskaźnik na plik otwarty do odczytu;
+ * @param[in] max – maksymalna liczba wczytywanych zmian.
+ * @return Wskaźnik na ciąg zmian, pusty na końcu pliku, lub NULL, gdy plik
+ *         zawiera niepoprawny wiersz, wystąpił błąd odczytu lub nie udało
+ *         się alokować pamięci.
+ */
+PhoneChanges *phchgRead(FILE *file, size_t max);
+
+/** @brief Zamraża strukturę.
+ * Zastępuje drzewa przechowujące przekierowania zwartą, niezmienną
+ * reprezentacją, która zajmuje znacznie mniej pamięci i szybciej odpowiada
+ * na zapytania. Po zamrożeniu funkcje @ref phfwdGet, @ref phfwdReverse,
+ * @ref phfwdGetReverse i @ref phfwdSave działają jak dotychczas, natomiast
+ * @ref phfwdAdd zwraca @p false, a @ref phfwdRemove nic nie robi. Ponowne
+ * zamrożenie nic nie zmienia.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli struktura jest zamrożona.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci (struktura
+ *         pozostaje wtedy niezmieniona) lub @p pf wynosi NULL.
+ */
+bool phfwdFreeze(PhoneForward *pf);
+
+/** @brief Zapisuje migawkę przekierowań.
+ * Zapisuje wszystkie przekierowania ze struktury @p pf do pliku @p path,
+ * po jednym w wierszu, w postaci dwóch numerów oddzielonych spacją. Plik jest
+ * podmieniany atomowo: najpierw zapisywany i utrwalany jest plik tymczasowy,
+ * który następnie zastępuje plik @p path, a na koniec utrwalany jest katalog
+ * zawierający @p path.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] path – ścieżka do pliku migawki.
+ * @return Wartość @p true, jeśli migawka została zapisana.
+ *         Wartość @p false, jeśli wystąpił błąd zapisu lub @p pf wynosi NULL.
+ */
+bool phfwdSave(PhoneForward const *pf, char const *path);
+
+/** @brief Wczytuje migawkę przekierowań.
+ * Tworzy nową strukturę zawierającą przekierowania zapisane w pliku @p path
+ * przez funkcję @ref phfwdSave.
+ * @param[in] path – ścieżka do pliku migawki.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         odczytać pliku, plik jest niepoprawny lub nie udało się alokować
+ *         pamięci.
+ */
+PhoneForward *phfwdLoad(char const *path);
+
+/** @brief Włącza dziennik operacji.
+ * Od tej chwili każde wywołanie @ref phfwdRemove jest przed wykonaniem,
+ * a każde udane wywołanie @ref phfwdAdd po wykonaniu, dopisywane do dziennika
+ * @p path. Zapisy są utrwalane na dysku grupami po @p batch operacji, więc
+ * po awarii mogą zostać utracone co najwyżej ostatnie niepełne grupy.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] path   – ścieżka do pliku dziennika;
+ * @param[in] batch  – liczba operacji utrwalanych jednym wywołaniem fsync.
+ * @return Wartość @p true, jeśli dziennik został otwarty.
+ *         Wartość @p false, jeśli @p pf wynosi NULL, dziennik jest już
+ *         włączony lub nie udało się otworzyć pliku.
+ */
+bool phfwdJournalOpen(PhoneForward *pf, char const *path, size_t batch);
+
+/** @brief Utrwala dziennik operacji.
+ * Zapisuje na dysk wszystkie operacje oczekujące w dzienniku struktury @p pf.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli operacja się powiodła lub dziennik nie jest
+ *         włączony. Wartość @p false w przypadku błędu zapisu.
+ */
+bool phfwdJournalSync(PhoneForward *pf);
+
+/** @brief Odtwarza strukturę po awarii.
+ * Wczytuje migawkę @p snapshot (jeśli istnieje), odtwarza na niej operacje
+ * zapisane w dzienniku @p journal i włącza dziennik dla dalszych operacji.
+ * Niekompletny ostatni zapis dziennika jest z niego usuwany, aby nie
+ * połączył się z kolejnym.
+ * @param[in] snapshot – ścieżka do pliku migawki;
+ * @param[in] journal  – ścieżka do pliku dziennika;
+ * @param[in] batch    – liczba operacji utrwalanych jednym wywołaniem fsync.
+ * @return Wskaźnik na odtworzoną strukturę lub NULL, gdy wystąpił błąd.
+ */
+PhoneForward *phfwdRecover(char const *snapshot, char const *journal,
+                           size_t batch);
+
+/** @brief Rozpoczyna kompaktowanie dziennika.
+ * Zapisuje w tle (w procesie potomnym) migawkę @p snapshot aktualnego stanu
+ * struktury. Po utrwaleniu jej i jej wpisu w katalogu operacje zawarte
+ * w migawce są usuwane z dziennika przez @ref phfwdCheckpointFinish. W tym
+ * czasie struktura może być dalej modyfikowana.
+ * @param[in,out] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] snapshot – ścieżka do pliku migawki.
+ * @return Wartość @p true, jeśli kompaktowanie zostało rozpoczęte.
+ *         Wartość @p false, jeśli dziennik nie jest włączony, poprzednie
+ *         kompaktowanie jeszcze trwa lub wystąpił błąd.
+ */
+bool phfwdCheckpoint(PhoneForward *pf, char const *snapshot);
+
+/** @brief Kończy kompaktowanie dziennika.
+ * Sprawdza, czy zakończył się zapis migawki rozpoczęty przez
+ * @ref phfwdCheckpoint, i jeśli tak, skraca dziennik.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] wait   – czy czekać na zakończenie zapisu migawki.
+ * @return Wartość @p true, jeśli nie trwa żadne kompaktowanie.
+ *         Wartość @p false, jeśli zapis migawki jeszcze trwa.
+ */
+bool phfwdCheckpointFinish(PhoneForward *pf, bool wait);
+
 #endif /* __PHONE_FORWARD_H__ */
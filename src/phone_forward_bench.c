@@ -0,0 +1,410 @@
+/** @file
+ * Pomiary wydajności struktury przechowującej przekierowania numerów.
+ *
+ * Buduje struktury z losowymi przekierowaniami numerów dziesiętnych
+ * i mierzy czas operacji oraz zajętą pamięć.
+ * Wywołanie: phone_forward_bench [PRZEKIEROWANIA] [ZAPYTANIA]
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "phone_forward.h"
+
+/**
+ * Maksymalna długość losowanego numeru.
+ */
+#define MAX_NUMBER 12
+
+/**
+ * Liczba powtórzeń pomiaru wariantów alfabetu.
+ */
+#define ALPHABET_ROUNDS 3
+
+/**
+ * To jest struktura przechowująca losowe dane pomiarów.
+ */
+typedef struct Input {
+    char (*from)[MAX_NUMBER + 1];    ///< numery przekierowywane
+    char (*to)[MAX_NUMBER + 1];      ///< numery docelowe przekierowań
+    char (*queries)[MAX_NUMBER + 1]; ///< numery, o które są zapytania
+    size_t count;                    ///< liczba przekierowań
+    size_t queryCount;               ///< liczba zapytań
+} Input;
+
+/** @brief Podaje aktualny czas.
+ * @return Liczba sekund od ustalonej chwili.
+ */
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+}
+
+/** @brief Podaje ilość pamięci zajętej na stercie.
+ * @return Liczba zaalokowanych bajtów lub 0, jeśli nie da się jej ustalić.
+ */
+static size_t heapUsed(void) {
+#ifdef __GLIBC__
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/** @brief Podaje ilość pamięci zajętej przez proces.
+ * @return Liczba bajtów pamięci rezydentnej procesu lub 0, jeśli nie da się
+ *         jej ustalić.
+ */
+static size_t memoryUsed(void) {
+    FILE *file = fopen("/proc/self/statm", "r");
+    unsigned long size, resident = 0;
+    if (file != NULL) {
+        if (fscanf(file, "%lu %lu", &size, &resident) != 2)
+            resident = 0;
+        fclose(file);
+    }
+    return (size_t) resident * (size_t) sysconf(_SC_PAGESIZE);
+}
+
+/** @brief Losuje numer dziesiętny.
+ * Numery zaczynają się od jednego z kilku popularnych prefiksów, tak jak
+ * numery kierunkowe w rzeczywistych planach numeracji.
+ * @param[out] number – miejsce na wylosowany numer;
+ * @param[in] min – minimalna długość numeru.
+ */
+static void randomNumber(char *number, size_t min) {
+    size_t length = min + (size_t) rand() % (MAX_NUMBER - min + 1);
+    number[0] = (char) ('1' + rand() % 4);
+    number[1] = (char) ('0' + rand() % 3);
+    for (size_t i = 2; i < length; i++)
+        number[i] = (char) ('0' + rand() % 10);
+    number[length] = '\0';
+}
+
+/** @brief Buduje strukturę z przekierowaniami.
+ * @param[in] create – funkcja tworząca pustą strukturę;
+ * @param[in] input – wskaźnik na dane pomiarów;
+ * @param[out] seconds – czas dodawania przekierowań.
+ * @return Wskaźnik na zbudowaną strukturę.
+ */
+static PhoneForward *build(PhoneForward *(*create)(void), Input const *input,
+                           double *seconds) {
+    double start = now();
+    PhoneForward *pf = create();
+    for (size_t i = 0; pf != NULL && i < input->count; i++)
+        phfwdAdd(pf, input->from[i], input->to[i]);
+    *seconds = now() - start;
+    return pf;
+}
+
+/** @brief Mierzy czas zapytań @ref phfwdGet.
+ * @param[in] pf – wskaźnik na strukturę z przekierowaniami;
+ * @param[in] input – wskaźnik na dane pomiarów.
+ * @return Średni czas jednego zapytania w nanosekundach.
+ */
+static double measureGet(PhoneForward const *pf, Input const *input) {
+    double start = now();
+    for (size_t i = 0; i < input->queryCount; i++)
+        phnumDelete(phfwdGet(pf, input->queries[i]));
+    return (now() - start) * 1e9 / (double) input->queryCount;
+}
+
+/** @brief Mierzy czas zapytań @ref phfwdReverse.
+ * @param[in] pf – wskaźnik na strukturę z przekierowaniami;
+ * @param[in] input – wskaźnik na dane pomiarów.
+ * @return Średni czas jednego zapytania w nanosekundach.
+ */
+static double measureReverse(PhoneForward const *pf, Input const *input) {
+    double start = now();
+    for (size_t i = 0; i < input->queryCount; i++)
+        phnumDelete(phfwdReverse(pf, input->queries[i]));
+    return (now() - start) * 1e9 / (double) input->queryCount;
+}
+
+/** @brief Porównuje warianty alfabetu struktury.
+ * Warianty są mierzone na przemian, a wynikiem jest najlepszy czas z kilku
+ * powtórzeń, aby kolejność pomiarów nie faworyzowała żadnego z nich.
+ * @param[in] input – wskaźnik na dane pomiarów.
+ */
+static void benchAlphabet(Input const *input) {
+    PhoneForward *(*variants[])(void) = {phfwdNew, phfwdNewDecimal};
+    char const *names[] = {"12 cyfr", "10 cyfr"};
+    size_t memory[2] = {0, 0};
+    double added[2] = {0, 0}, get[2] = {0, 0};
+    for (size_t round = 0; round < ALPHABET_ROUNDS; round++) {
+        for (size_t v = 0; v < 2; v++) {
+            size_t before = heapUsed();
+            double seconds;
+            PhoneForward *pf = build(variants[v], input, &seconds);
+            memory[v] = heapUsed() - before;
+            double query = measureGet(pf, input);
+            if (round == 0 || seconds < added[v])
+                added[v] = seconds;
+            if (round == 0 || query < get[v])
+                get[v] = query;
+            phfwdDelete(pf);
+        }
+    }
+    for (size_t v = 0; v < 2; v++)
+        printf("alfabet %s: pamięć %.1f MB, dodawanie %.0f ns, "
+               "phfwdGet %.0f ns\n", names[v], (double) memory[v] / 1e6,
+               added[v] * 1e9 / (double) input->count, get[v]);
+}
+
+/** @brief Mierzy wpływ kompaktowania na zapytania.
+ * Buduje strukturę, usuwa i dodaje ponownie część przekierowań, tak aby
+ * węzły rozproszyły się po stercie, i porównuje czas zapytań przed i po
+ * wywołaniu @ref phfwdCompact.
+ * @param[in] input – wskaźnik na dane pomiarów.
+ */
+static void benchCompact(Input const *input) {
+    double added;
+    PhoneForward *pf = build(phfwdNew, input, &added);
+    for (size_t i = 0; i < input->count; i += 2)
+        phfwdRemove(pf, input->from[i]);
+    for (size_t i = 0; i < input->count; i += 2)
+        phfwdAdd(pf, input->from[i], input->to[i]);
+    size_t before = memoryUsed();
+    double get = measureGet(pf, input);
+    double start = now();
+    phfwdCompact(pf);
+    double compacted = now() - start;
+    printf("kompaktowanie: %.2f s, pamięć %.1f MB -> %.1f MB, "
+           "phfwdGet %.0f ns -> %.0f ns\n", compacted, (double) before / 1e6,
+           (double) memoryUsed() / 1e6, get, measureGet(pf, input));
+    phfwdDelete(pf);
+}
+
+/** @brief Mierzy wpływ tablicy skoków na zapytania.
+ * Porównuje czas zapytań @ref phfwdGet bez tablicy skoków i z tablicami
+ * obejmującymi kolejne liczby poziomów drzewa.
+ * @param[in] input – wskaźnik na dane pomiarów.
+ */
+static void benchJump(Input const *input) {
+    double added;
+    PhoneForward *pf = build(phfwdNew, input, &added);
+    printf("tablica skoków: phfwdGet %.0f ns", measureGet(pf, input));
+    for (size_t levels = 1; levels <= 4; levels++) {
+        if (phfwdSetJumpLevels(pf, levels))
+            printf(", %zu poz. %.0f ns", levels, measureGet(pf, input));
+    }
+    printf("\n");
+    phfwdDelete(pf);
+}
+
+/** @brief Mierzy czas wyznaczania różnicy między strukturami.
+ * Buduje dwie struktury z tymi samymi przekierowaniami, zmienia w drugiej
+ * co tysięczne przekierowanie i mierzy czas @ref phfwdDiff.
+ * @param[in] input – wskaźnik na dane pomiarów.
+ */
+static void benchDiff(Input const *input) {
+    double added;
+    PhoneForward *a = build(phfwdNew, input, &added);
+    PhoneForward *b = build(phfwdNew, input, &added);
+    for (size_t i = 0; i < input->count; i += 1000)
+        phfwdAdd(b, input->from[i], input->queries[i % input->queryCount]);
+    double start = now();
+    PhoneChanges *changes = phfwdDiff(a, b);
+    printf("różnica: %zu zmian w %.3f ms\n", phchgSize(changes),
+           (now() - start) * 1e3);
+    phchgDelete(changes);
+    phfwdDelete(a);
+    phfwdDelete(b);
+}
+
+/** @brief Mierzy wpływ publikacji migawki na zapytania.
+ * Porównuje czas zapytań @ref phfwdGet przed i po wywołaniu
+ * @ref phfwdPublish.
+ * @param[in] input – wskaźnik na dane pomiarów.
+ */
+static void benchPublish(Input const *input) {
+    double added;
+    PhoneForward *pf = build(phfwdNew, input, &added);
+    double get = measureGet(pf, input);
+    double start = now();
+    if (phfwdPublish(pf))
+        printf("publikacja: %.2f s, %zu kopii, phfwdGet %.0f ns -> %.0f ns\n",
+               now() - start, phfwdReplicas(pf), get, measureGet(pf, input));
+    phfwdDelete(pf);
+}
+
+/** @brief Mierzy wpływ zamrożenia na pamięć i zapytania.
+ * Porównuje pamięć zajętą przez strukturę oraz czas zapytań @ref phfwdGet
+ * i @ref phfwdReverse przed i po wywołaniu @ref phfwdFreeze.
+ * @param[in] input – wskaźnik na dane pomiarów.
+ */
+static void benchFreeze(Input const *input) {
+    size_t before = heapUsed();
+    double added;
+    PhoneForward *pf = build(phfwdNew, input, &added);
+    size_t memory = heapUsed() - before;
+    double get = measureGet(pf, input);
+    double reverse = measureReverse(pf, input);
+    double start = now();
+    if (!phfwdFreeze(pf)) {
+        fprintf(stderr, "Nie udało się zamrozić struktury.\n");
+        phfwdDelete(pf);
+        return;
+    }
+    double frozen = now() - start;
+    printf("zamrażanie: %.2f s, pamięć %.1f MB -> %.1f MB, "
+           "phfwdGet %.0f ns -> %.0f ns, phfwdReverse %.0f ns -> %.0f ns\n",
+           frozen, (double) memory / 1e6, (double) (heapUsed() - before) / 1e6,
+           get, measureGet(pf, input), reverse, measureReverse(pf, input));
+    phfwdDelete(pf);
+}
+
+/** @brief Mierzy zysk z filtrowania wyniku w trakcie zapytania odwrotnego.
+ * Przekierowuje co dwudziesty numer na jeden prefiks i porównuje czas
+ * @ref phfwdReverse z czasem @ref phfwdReverseFiltered zwracającego dziesięć
+ * najmniejszych numerów oraz numery o zadanym prefiksie.
+ * @param[in] input – wskaźnik na dane pomiarów.
+ */
+static void benchFilter(Input const *input) {
+    PhoneForward *pf = phfwdNew();
+    for (size_t i = 0; pf != NULL && i < input->count; i += 20)
+        phfwdAdd(pf, input->from[i], "0");
+    size_t rounds = 5;
+    PhoneFilter top = {NULL, NULL, NULL, 10};
+    PhoneFilter prefix = {NULL, NULL, "123", 0};
+    double start = now();
+    for (size_t i = 0; i < rounds; i++)
+        phnumDelete(phfwdReverse(pf, "0"));
+    double full = (now() - start) * 1e3 / (double) rounds;
+    start = now();
+    for (size_t i = 0; i < rounds; i++)
+        phnumDelete(phfwdReverseFiltered(pf, "0", &top));
+    double limited = (now() - start) * 1e3 / (double) rounds;
+    start = now();
+    for (size_t i = 0; i < rounds; i++)
+        phnumDelete(phfwdReverseFiltered(pf, "0", &prefix));
+    printf("filtrowanie: phfwdReverse %.2f ms, 10 najmniejszych %.3f ms, "
+           "prefiks 123 %.3f ms\n", full, limited,
+           (now() - start) * 1e3 / (double) rounds);
+    phfwdDelete(pf);
+}
+
+/** @brief Porównuje zapytania odwrotne wsadowe z pojedynczymi.
+ * Mierzy czas wyznaczenia wyników @ref phfwdGetReverse dla wszystkich
+ * zapytań w pętli oraz jednym wywołaniem @ref phfwdGetReverseBatch.
+ * @param[in] input – wskaźnik na dane pomiarów.
+ */
+static void benchBatch(Input const *input) {
+    double added;
+    PhoneForward *pf = build(phfwdNew, input, &added);
+    char const **nums = malloc(input->queryCount * sizeof(char const *));
+    PhoneNumbers **results = malloc(input->queryCount *
+                                    sizeof(PhoneNumbers *));
+    if (pf == NULL || nums == NULL || results == NULL) {
+        fprintf(stderr, "Brak pamięci.\n");
+        free(nums);
+        free(results);
+        phfwdDelete(pf);
+        return;
+    }
+    for (size_t i = 0; i < input->queryCount; i++)
+        nums[i] = input->queries[i];
+    double start = now();
+    for (size_t i = 0; i < input->queryCount; i++)
+        phnumDelete(phfwdGetReverse(pf, nums[i]));
+    double single = now() - start;
+    start = now();
+    if (phfwdGetReverseBatch(pf, nums, input->queryCount, results)) {
+        double batch = now() - start;
+        for (size_t i = 0; i < input->queryCount; i++)
+            phnumDelete(results[i]);
+        printf("zapytania wsadowe: phfwdGetReverse %.0f ns -> %.0f ns\n",
+               single * 1e9 / (double) input->queryCount,
+               batch * 1e9 / (double) input->queryCount);
+    }
+    free(nums);
+    free(results);
+    phfwdDelete(pf);
+}
+
+/** @brief Porównuje budowanie równoległe z dodawaniem kolejnych przekierowań.
+ * Mierzy czas budowania struktury funkcją @ref phfwdBuild dla kolejnych
+ * potęg dwójki wątków, nie większych od liczby procesorów.
+ * @param[in] input – wskaźnik na dane pomiarów.
+ */
+static void benchBuild(Input const *input) {
+    char const **num1s = malloc(input->count * sizeof(char const *));
+    char const **num2s = malloc(input->count * sizeof(char const *));
+    if (num1s == NULL || num2s == NULL) {
+        fprintf(stderr, "Brak pamięci.\n");
+        free(num1s);
+        free(num2s);
+        return;
+    }
+    for (size_t i = 0; i < input->count; i++) {
+        num1s[i] = input->from[i];
+        num2s[i] = input->to[i];
+    }
+    double added;
+    phfwdDelete(build(phfwdNew, input, &added));
+    printf("budowanie: phfwdAdd %.2f s", added);
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    for (size_t threads = 1; threads <= (size_t) (online > 1 ? online : 1);
+         threads *= 2) {
+        double start = now();
+        PhoneForward *pf = phfwdBuild(num1s, num2s, input->count, threads);
+        if (pf != NULL)
+            printf(", %zu wątk. %.2f s", threads, now() - start);
+        phfwdDelete(pf);
+    }
+    printf("\n");
+    free(num1s);
+    free(num2s);
+}
+
+int main(int argc, char *argv[]) {
+    Input input;
+    input.count = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    input.queryCount = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+    if (input.count == 0 || input.queryCount == 0) {
+        fprintf(stderr, "Użycie: %s [PRZEKIEROWANIA] [ZAPYTANIA]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    input.from = malloc(input.count * sizeof *input.from);
+    input.to = malloc(input.count * sizeof *input.to);
+    input.queries = malloc(input.queryCount * sizeof *input.queries);
+    if (input.from == NULL || input.to == NULL || input.queries == NULL) {
+        fprintf(stderr, "Brak pamięci.\n");
+        return EXIT_FAILURE;
+    }
+    srand(2022);
+    for (size_t i = 0; i < input.count; i++) {
+        randomNumber(input.from[i], 4);
+        randomNumber(input.to[i], 4);
+    }
+    for (size_t i = 0; i < input.queryCount; i++)
+        randomNumber(input.queries[i], MAX_NUMBER);
+
+    benchAlphabet(&input);
+    benchBuild(&input);
+    benchCompact(&input);
+    benchJump(&input);
+    benchPublish(&input);
+    benchDiff(&input);
+    benchFreeze(&input);
+    benchFilter(&input);
+    benchBatch(&input);
+
+    free(input.from);
+    free(input.to);
+    free(input.queries);
+    return EXIT_SUCCESS;
+}
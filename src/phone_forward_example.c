@@ -4,9 +4,74 @@
 
 #include "phone_forward.h"
 #include <assert.h>
+#include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 #define MAX_LEN 23
+#define BUILD_PAIRS 3000
+
+static bool sameNumbers(PhoneNumbers *pnum1, PhoneNumbers *pnum2) {
+    bool same = pnum1 != NULL && pnum2 != NULL;
+    for (size_t i = 0; same; i++) {
+        char const *num1 = phnumGet(pnum1, i), *num2 = phnumGet(pnum2, i);
+        if (num1 == NULL || num2 == NULL) {
+            same = num1 == num2;
+            break;
+        }
+        same = strcmp(num1, num2) == 0;
+    }
+    phnumDelete(pnum1);
+    phnumDelete(pnum2);
+    return same;
+}
+
+static void randomNumber(char *num, unsigned *seed) {
+    static char const digits[] = "0123456789*#";
+    *seed = *seed * 1103515245 + 12345;
+    size_t length = 1 + (*seed >> 16) % 6;
+    for (size_t i = 0; i < length; i++) {
+        *seed = *seed * 1103515245 + 12345;
+        num[i] = digits[(*seed >> 16) % 12];
+    }
+    num[length] = '\0';
+}
+
+// phfwdBuild musi dawać to samo co kolejne phfwdAdd: powtórzony numer
+// przekierowywany przyjmuje ostatnie przekierowanie, a niepoprawne są
+// pomijane.
+static void checkBuild(size_t threads) {
+    static char from[BUILD_PAIRS][MAX_LEN + 1], to[BUILD_PAIRS][MAX_LEN + 1];
+    char const *num1s[BUILD_PAIRS], *num2s[BUILD_PAIRS];
+    unsigned seed = 2022;
+    for (size_t i = 0; i < BUILD_PAIRS; i++) {
+        randomNumber(from[i], &seed);
+        randomNumber(to[i], &seed);
+        if (i > 0 && seed % 4 == 0)
+            strcpy(from[i], from[seed % i]);
+        if (seed % 50 == 1)
+            strcpy(to[i], from[i]);
+        num1s[i] = from[i];
+        num2s[i] = to[i];
+    }
+    PhoneForward *pf = phfwdNew();
+    for (size_t i = 0; i < BUILD_PAIRS; i++)
+        phfwdAdd(pf, num1s[i], num2s[i]);
+    PhoneForward *built = phfwdBuild(num1s, num2s, BUILD_PAIRS, threads);
+    assert(pf != NULL && built != NULL);
+    for (size_t i = 0; i < BUILD_PAIRS; i++) {
+        assert(sameNumbers(phfwdGet(pf, from[i]), phfwdGet(built, from[i])));
+        assert(sameNumbers(phfwdGet(pf, to[i]), phfwdGet(built, to[i])));
+        assert(sameNumbers(phfwdReverse(pf, to[i]),
+                           phfwdReverse(built, to[i])));
+        assert(sameNumbers(phfwdReverse(pf, from[i]),
+                           phfwdReverse(built, from[i])));
+    }
+    PhoneChanges *changes = phfwdDiff(pf, built);
+    assert(changes != NULL && phchgSize(changes) == 0);
+    phchgDelete(changes);
+    phfwdDelete(built);
+    phfwdDelete(pf);
+}
 
 int main() {
 
@@ -145,4 +210,7 @@ int main() {
     phnumDelete(pnum);
     */
     phfwdDelete(pf);
+
+    for (size_t threads = 1; threads <= 8; threads *= 2)
+        checkBuild(threads);
 }
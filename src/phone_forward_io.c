@@ -0,0 +1,291 @@
+/** @file
+ * Narzędzie do wczytywania i zapisywania planów przekierowań.
+ *
+ * Wczytuje plik z przekierowaniami (po jednym w wierszu, dwa numery
+ * oddzielone białymi znakami), dzieli go na fragmenty analizowane
+ * równolegle przez kilka wątków, buduje z poprawnych przekierowań strukturę
+ * funkcją @ref phfwdBuild i zapisuje ją do pliku wyjściowego w formacie
+ * funkcji @ref phfwdSave.
+ * Wywołanie: phone_forward_io WEJŚCIE WYJŚCIE [WĄTKI]
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "phone_forward.h"
+
+/**
+ * Maksymalna liczba wątków analizujących plik.
+ */
+#define MAX_THREADS 64
+
+/**
+ * To jest struktura opisująca fragment pliku analizowany przez jeden wątek.
+ */
+typedef struct Chunk {
+    char const *begin; ///< początek fragmentu
+    char const *end;   ///< koniec fragmentu
+    char *numbers;     ///< numery poprawnych par zakończone znakami '\0'
+    size_t used;       ///< liczba zajętych bajtów tablicy @p numbers
+    size_t capacity;   ///< rozmiar tablicy @p numbers
+    size_t *pairs;     ///< pozycje numerów par w @p numbers: num1, num2, ...
+    size_t count;      ///< liczba znalezionych poprawnych par
+    size_t invalid;    ///< liczba niepoprawnych niepustych wierszy
+    bool failed;       ///< czy wystąpił błąd alokacji pamięci
+} Chunk;
+
+/** @brief Podaje aktualny czas.
+ * @return Liczba sekund od ustalonej chwili.
+ */
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+}
+
+/** @brief Sprawdza, czy znak jest białym znakiem w wierszu.
+ * @param[in] c – sprawdzany znak.
+ * @return Wartość @p true, jeśli @p c jest spacją, tabulacją lub powrotem
+ *         karetki.
+ */
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/** @brief Wydziela kolejne słowo wiersza.
+ * Pomija białe znaki i wyznacza granice następującego po nich słowa.
+ * @param[in,out] position – wskaźnik na bieżącą pozycję w wierszu;
+ * @param[in] end – koniec wiersza (wskazuje znak końca wiersza lub pliku);
+ * @param[out] length – długość znalezionego słowa.
+ * @return Wskaźnik na początek słowa lub NULL, jeśli w wierszu nie ma już
+ *         słów.
+ */
+static char const *nextWord(char const **position, char const *end,
+                            size_t *length) {
+    char const *word = *position;
+    while (word < end && isBlank(word[0]))
+        word++;
+    if (word == end)
+        return NULL;
+    char const *after = word;
+    while (after < end && !isBlank(after[0]))
+        after++;
+    *position = after;
+    *length = (size_t) (after - word);
+    return word;
+}
+
+/** @brief Zapewnia miejsce w tablicy.
+ * Powiększa dwukrotnie tablicę @p array, dopóki nie zmieści @p needed
+ * elementów.
+ * @param[in] array – wskaźnik na tablicę lub NULL;
+ * @param[in,out] capacity – wskaźnik na liczbę elementów tablicy;
+ * @param[in] needed – wymagana liczba elementów;
+ * @param[in] size – rozmiar elementu.
+ * @return Wskaźnik na tablicę, która mieści @p needed elementów, lub NULL,
+ *         jeśli nie udało się alokować pamięci (@p array pozostaje wtedy
+ *         ważna).
+ */
+static void *reserve(void *array, size_t *capacity, size_t needed,
+                     size_t size) {
+    if (needed <= *capacity)
+        return array;
+    size_t grown = *capacity == 0 ? 1024 : *capacity;
+    while (grown < needed)
+        grown *= 2;
+    void *ptr = realloc(array, grown * size);
+    if (ptr != NULL)
+        *capacity = grown;
+    return ptr;
+}
+
+/** @brief Analizuje fragment pliku.
+ * Dzieli fragment na wiersze, wydziela z nich numery i sprawdza ich
+ * poprawność. Numery znalezionych par kopiuje do tablicy @p numbers
+ * fragmentu, a ich pozycje zapisuje w tablicy @p pairs. Sam plik jest tylko
+ * czytany.
+ * @param[in,out] data – wskaźnik na strukturę typu Chunk.
+ * @return NULL.
+ */
+static void *parseChunk(void *data) {
+    Chunk *chunk = data;
+    size_t size = 0;
+    char const *line = chunk->begin;
+    while (line < chunk->end && !chunk->failed) {
+        char const *end = memchr(line, '\n', (size_t) (chunk->end - line));
+        if (end == NULL)
+            end = chunk->end;
+        char const *position = line;
+        size_t length1, length2, length3;
+        char const *num1 = nextWord(&position, end, &length1);
+        char const *num2 = num1 == NULL ? NULL
+                                        : nextWord(&position, end, &length2);
+        bool extra = num2 != NULL &&
+                     nextWord(&position, end, &length3) != NULL;
+        if (num1 != NULL) {
+            size_t needed = chunk->used + length1 + 1 +
+                            (num2 != NULL ? length2 + 1 : 0);
+            char *numbers = reserve(chunk->numbers, &chunk->capacity,
+                                    needed, 1);
+            if (numbers != NULL)
+                chunk->numbers = numbers;
+            size_t *pairs = numbers == NULL ? NULL
+                            : reserve(chunk->pairs, &size,
+                                      2 * chunk->count + 2, sizeof(size_t));
+            if (pairs == NULL) {
+                chunk->failed = true;
+                break;
+            }
+            chunk->pairs = pairs;
+            char *copy1 = chunk->numbers + chunk->used;
+            memcpy(copy1, num1, length1);
+            copy1[length1] = '\0';
+            char *copy2 = copy1 + length1 + 1;
+            if (num2 != NULL) {
+                memcpy(copy2, num2, length2);
+                copy2[length2] = '\0';
+            }
+            if (extra || num2 == NULL || !isItNumber(copy1) ||
+                !isItNumber(copy2)) {
+                chunk->invalid++;
+            } else {
+                chunk->pairs[2 * chunk->count] = chunk->used;
+                chunk->pairs[2 * chunk->count + 1] = chunk->used + length1 + 1;
+                chunk->count++;
+                chunk->used = needed;
+            }
+        }
+        line = end + 1;
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Użycie: %s WEJŚCIE WYJŚCIE [WĄTKI]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    long threads = argc == 4 ? strtol(argv[3], NULL, 10)
+                             : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+
+    int fd = open(argv[1], O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    size_t length = (size_t) info.st_size;
+    // Plik jest tylko czytany, a numery są kopiowane, więc strony
+    // odwzorowania nie są kopiowane przy zapisie i jądro może je zwolnić.
+    char const *text = length == 0 ? NULL
+                                   : mmap(NULL, length, PROT_READ, MAP_PRIVATE,
+                                          fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    if (text != NULL)
+        posix_madvise((void *) text, length, POSIX_MADV_SEQUENTIAL);
+
+    double start = now();
+    Chunk chunks[MAX_THREADS];
+    pthread_t ids[MAX_THREADS];
+    char const *begin = text;
+    for (long t = 0; t < threads; t++) {
+        char const *end = t == threads - 1
+                          ? text + length
+                          : text + length / (size_t) threads * (size_t) (t + 1);
+        if (end < begin)
+            end = begin;
+        while (end < text + length && end > text && end[-1] != '\n')
+            end++;
+        chunks[t] = (Chunk) {begin, end, NULL, 0, 0, NULL, 0, 0, false};
+        begin = end;
+    }
+    long started = 0;
+    while (started + 1 < threads &&
+           pthread_create(&ids[started], NULL, parseChunk,
+                          &chunks[started]) == 0)
+        started++;
+    for (long t = started; t < threads; t++)
+        parseChunk(&chunks[t]);
+    for (long t = 0; t < started; t++)
+        pthread_join(ids[t], NULL);
+    if (text != NULL)
+        munmap((void *) text, length);
+    double parsed = now();
+
+    size_t total = 0, invalid = 0;
+    bool failed = false;
+    for (long t = 0; t < threads; t++) {
+        total += chunks[t].count;
+        invalid += chunks[t].invalid;
+        failed = failed || chunks[t].failed;
+    }
+    fprintf(stderr, "analiza: %zu par, %zu błędnych wierszy, %.2f s, "
+                    "%.1f MB/s (%ld wątków)\n", total, invalid,
+            parsed - start, (double) length / 1e6 / (parsed - start + 1e-9),
+            threads);
+
+    // Przekierowania numeru na siebie są jedynymi poprawnymi parami, które
+    // odrzuca phfwdAdd, a więc i phfwdBuild.
+    char const **num1s = failed ? NULL : malloc((total + 1) * sizeof(char *));
+    char const **num2s = failed ? NULL : malloc((total + 1) * sizeof(char *));
+    size_t count = 0, rejected = 0;
+    for (long t = 0; t < threads && num1s != NULL && num2s != NULL; t++) {
+        for (size_t i = 0; i < chunks[t].count; i++) {
+            num1s[count] = chunks[t].numbers + chunks[t].pairs[2 * i];
+            num2s[count] = chunks[t].numbers + chunks[t].pairs[2 * i + 1];
+            if (strcmp(num1s[count], num2s[count]) == 0)
+                rejected++;
+            count++;
+        }
+    }
+    PhoneForward *pf = num1s != NULL && num2s != NULL
+                       ? phfwdBuild(num1s, num2s, count, (size_t) threads)
+                       : NULL;
+    free(num1s);
+    free(num2s);
+    for (long t = 0; t < threads; t++) {
+        free(chunks[t].numbers);
+        free(chunks[t].pairs);
+    }
+    if (pf == NULL) {
+        fprintf(stderr, "Brak pamięci.\n");
+        return EXIT_FAILURE;
+    }
+    double built = now();
+    fprintf(stderr, "budowanie: %zu dodanych, %zu odrzuconych, %.2f s, "
+                    "%.0f par/s\n", count - rejected, rejected, built - parsed,
+            (double) count / (built - parsed + 1e-9));
+
+    bool saved = phfwdSave(pf, argv[2]);
+    double exported = now();
+    phfwdDelete(pf);
+    if (!saved) {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+    struct stat out;
+    double size = stat(argv[2], &out) == 0 ? (double) out.st_size : 0;
+    fprintf(stderr, "zapis: %.2f s, %.1f MB/s\n", exported - built,
+            size / 1e6 / (exported - built + 1e-9));
+    return EXIT_SUCCESS;
+}
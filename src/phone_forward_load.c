@@ -0,0 +1,268 @@
+/** @file
+ * Generator obciążenia serwera przekierowań numerów telefonów.
+ *
+ * Otwiera kilka połączeń z serwerem, w każdym z nich wysyła partie losowych
+ * zapytań bez czekania na odpowiedzi na poszczególne zapytania i mierzy
+ * łączną przepustowość.
+ * Wywołanie: phone_forward_load ADRES [POŁĄCZENIA] [ZAPYTANIA] [PARTIA]
+ *            [get|reverse|getreverse]
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "protocol.h"
+
+/**
+ * Maksymalna liczba połączeń.
+ */
+#define MAX_CONNECTIONS 256
+
+/**
+ * Maksymalna długość losowanego numeru.
+ */
+#define MAX_NUMBER 12
+
+/**
+ * To jest struktura opisująca jedno połączenie generatora.
+ */
+typedef struct Client {
+    ProtoAddress const *address; ///< adres serwera
+    unsigned operation;          ///< kod wysyłanych zapytań
+    size_t queries;              ///< liczba zapytań do wysłania
+    size_t batch;                ///< liczba zapytań w jednej partii
+    unsigned seed;               ///< ziarno generatora liczb losowych
+    size_t answers;              ///< łączna liczba numerów w odpowiedziach
+    unsigned char *input;        ///< bufor odebranych danych
+    size_t filled;               ///< liczba bajtów w buforze
+    size_t capacity;             ///< rozmiar bufora
+    bool failed;                 ///< czy wystąpił błąd
+    pthread_t id;                ///< identyfikator wątku
+} Client;
+
+/** @brief Podaje aktualny czas.
+ * @return Liczba sekund od ustalonej chwili.
+ */
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+}
+
+/**
+ * Początkowy rozmiar bufora odpowiedzi.
+ */
+#define INPUT_BUFFER (64 * 1024)
+
+/** @brief Podaje długość pierwszej odpowiedzi w buforze.
+ * @param[in] buffer – odebrane dane;
+ * @param[in] length – liczba odebranych bajtów;
+ * @param[out] count – liczba numerów w odpowiedzi.
+ * @return Liczba bajtów pierwszej odpowiedzi lub 0, jeśli nie została ona
+ *         jeszcze odebrana w całości.
+ */
+static size_t responseLength(unsigned char const *buffer, size_t length,
+                             uint32_t *count) {
+    if (length < PROTO_RESPONSE_HEADER)
+        return 0;
+    *count = protoGet32(buffer);
+    if (*count == PROTO_ERROR)
+        return PROTO_RESPONSE_HEADER;
+    size_t position = PROTO_RESPONSE_HEADER;
+    for (uint32_t i = 0; i < *count; i++) {
+        if (length - position < 2)
+            return 0;
+        position += 2 + protoGet16(buffer + position);
+        if (position > length)
+            return 0;
+    }
+    return position;
+}
+
+/** @brief Odbiera dostępne dane i zlicza kompletne odpowiedzi.
+ * @param[in] fd – deskryptor gniazda;
+ * @param[in,out] client – wskaźnik na strukturę połączenia;
+ * @param[in,out] answered – liczba odebranych odpowiedzi.
+ * @return Wartość @p true, jeśli się udało.
+ */
+static bool receiveResponses(int fd, Client *client, size_t *answered) {
+    if (client->filled == client->capacity) {
+        unsigned char *input = realloc(client->input, 2 * client->capacity);
+        if (input == NULL)
+            return false;
+        client->input = input;
+        client->capacity *= 2;
+    }
+    ssize_t received = recv(fd, client->input + client->filled,
+                            client->capacity - client->filled, MSG_DONTWAIT);
+    if (received < 0)
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    if (received == 0)
+        return false;
+    client->filled += (size_t) received;
+    size_t position = 0, length;
+    uint32_t count;
+    while ((length = responseLength(client->input + position,
+                                    client->filled - position, &count)) > 0) {
+        if (count == PROTO_ERROR)
+            return false;
+        client->answers += count;
+        position += length;
+        (*answered)++;
+    }
+    memmove(client->input, client->input + position, client->filled - position);
+    client->filled -= position;
+    return true;
+}
+
+/** @brief Wysyła partię zapytań i odbiera odpowiedzi na nie.
+ * Wysyłanie przeplata z odbieraniem, aby serwer, który przestaje czytać
+ * połączenie z wieloma oczekującymi odpowiedziami, nie zablokował się razem
+ * z generatorem na pełnych buforach gniazda.
+ * @param[in] fd – deskryptor gniazda;
+ * @param[in,out] client – wskaźnik na strukturę połączenia;
+ * @param[in] requests – wysyłane zapytania;
+ * @param[in] length – liczba bajtów zapytań;
+ * @param[in] batch – liczba zapytań.
+ * @return Wartość @p true, jeśli się udało.
+ */
+static bool exchange(int fd, Client *client, unsigned char const *requests,
+                     size_t length, size_t batch) {
+    size_t sent = 0, answered = 0;
+    while (answered < batch) {
+        struct pollfd poller = {
+                fd, (short) (POLLIN | (sent < length ? POLLOUT : 0)), 0
+        };
+        if (poll(&poller, 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (poller.revents & POLLOUT) {
+            ssize_t written = send(fd, requests + sent, length - sent,
+                                   MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (written < 0 && errno != EINTR && errno != EAGAIN &&
+                errno != EWOULDBLOCK)
+                return false;
+            if (written > 0)
+                sent += (size_t) written;
+        }
+        if ((poller.revents & (POLLIN | POLLHUP | POLLERR)) &&
+            !receiveResponses(fd, client, &answered))
+            return false;
+    }
+    return true;
+}
+
+/** @brief Wykonuje zapytania jednego połączenia.
+ * @param[in,out] data – wskaźnik na strukturę typu Client.
+ * @return NULL.
+ */
+static void *clientLoop(void *data) {
+    Client *client = data;
+    int fd = socket(client->address->family, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr const *) &client->address->address,
+                          client->address->length) != 0) {
+        client->failed = true;
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    size_t size = client->batch * (PROTO_REQUEST_HEADER + MAX_NUMBER);
+    unsigned char *requests = malloc(size);
+    client->input = malloc(INPUT_BUFFER);
+    client->capacity = INPUT_BUFFER;
+    client->filled = 0;
+    client->failed = requests == NULL || client->input == NULL;
+    for (size_t done = 0; done < client->queries && !client->failed;) {
+        size_t batch = client->queries - done;
+        if (batch > client->batch)
+            batch = client->batch;
+        size_t length = 0;
+        for (size_t i = 0; i < batch; i++) {
+            size_t digits = 1 + (size_t) rand_r(&client->seed) % MAX_NUMBER;
+            requests[length] = (unsigned char) client->operation;
+            protoPut16(requests + length + 1, (uint16_t) digits);
+            length += PROTO_REQUEST_HEADER;
+            for (size_t j = 0; j < digits; j++)
+                requests[length++] =
+                        (unsigned char) ('0' + rand_r(&client->seed) % 10);
+        }
+        client->failed = !exchange(fd, client, requests, length, batch);
+        done += batch;
+    }
+    free(client->input);
+    free(requests);
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 6) {
+        fprintf(stderr, "Użycie: %s ADRES [POŁĄCZENIA] [ZAPYTANIA] [PARTIA] "
+                        "[get|reverse|getreverse]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    ProtoAddress address;
+    if (protoAddress(argv[1], &address) != 0) {
+        fprintf(stderr, "Niepoprawny adres %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    long connections = argc > 2 ? strtol(argv[2], NULL, 10) : 4;
+    long queries = argc > 3 ? strtol(argv[3], NULL, 10) : 1000000;
+    long batch = argc > 4 ? strtol(argv[4], NULL, 10) : 64;
+    unsigned operation = PROTO_GET;
+    if (argc > 5 && strcmp(argv[5], "reverse") == 0)
+        operation = PROTO_REVERSE;
+    else if (argc > 5 && strcmp(argv[5], "getreverse") == 0)
+        operation = PROTO_GET_REVERSE;
+    if (connections < 1 || connections > MAX_CONNECTIONS || queries < 1 ||
+        batch < 1) {
+        fprintf(stderr, "Niepoprawne parametry.\n");
+        return EXIT_FAILURE;
+    }
+
+    Client clients[MAX_CONNECTIONS];
+    double start = now();
+    for (long c = 0; c < connections; c++) {
+        clients[c] = (Client) {
+                &address, operation,
+                (size_t) (queries / connections +
+                          (c < queries % connections ? 1 : 0)),
+                (size_t) batch, (unsigned) c + 1, 0, NULL, 0, 0, false, 0
+        };
+        if (pthread_create(&clients[c].id, NULL, clientLoop,
+                           &clients[c]) != 0) {
+            perror("pthread_create");
+            return EXIT_FAILURE;
+        }
+    }
+    size_t answers = 0;
+    bool failed = false;
+    for (long c = 0; c < connections; c++) {
+        pthread_join(clients[c].id, NULL);
+        answers += clients[c].answers;
+        failed = failed || clients[c].failed;
+    }
+    double elapsed = now() - start;
+    printf("%ld zapytań w %.3f s: %.0f zapytań/s, %zu numerów w "
+           "odpowiedziach\n", queries, elapsed, (double) queries / elapsed,
+           answers);
+    if (failed) {
+        fprintf(stderr, "Część połączeń zakończyła się błędem.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,425 @@
+/** @file
+ * Serwer udostępniający zapytania o przekierowania numerów telefonów.
+ *
+ * Wczytuje migawkę zapisaną przez @ref phfwdSave i obsługuje zapytania
+ * @ref phfwdGet, @ref phfwdReverse i @ref phfwdGetReverse przesyłane
+ * w protokole opisanym w pliku protocol.h. Główny wątek przyjmuje połączenia
+ * i rozdziela je po kolei między wątki robocze. Każdy wątek roboczy obsługuje
+ * swoje połączenia we własnej pętli zdarzeń epoll: wykonuje wszystkie
+ * kompletne żądania odczytane z gniazda i wysyła odpowiedzi na nie jednym
+ * zapisem. Struktura przekierowań nie jest modyfikowana, więc wątki mogą
+ * z niej korzystać jednocześnie. Po wczytaniu przekierowania są publikowane
+ * funkcją @ref phfwdPublish, więc każdy wątek czyta kopię leżącą w pamięci
+ * swojego węzła NUMA.
+ * Wywołanie: phone_forward_server MIGAWKA ADRES [WĄTKI]
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "phone_forward.h"
+#include "protocol.h"
+
+/**
+ * Maksymalna liczba wątków roboczych.
+ */
+#define MAX_WORKERS 64
+
+/**
+ * Maksymalna liczba zdarzeń odbieranych jednym wywołaniem epoll_wait.
+ */
+#define MAX_EVENTS 64
+
+/**
+ * Rozmiar porcji danych odczytywanej z gniazda.
+ */
+#define READ_SIZE (64 * 1024)
+
+/**
+ * Rozmiar niewysłanych odpowiedzi, po którego przekroczeniu serwer przestaje
+ * czytać żądania z połączenia.
+ */
+#define OUTPUT_LIMIT (4 * 1024 * 1024)
+
+/**
+ * Czas w milisekundach, na jaki serwer wstrzymuje przyjmowanie połączeń,
+ * gdy zabrakło deskryptorów, a nie udało się odrzucić oczekującego
+ * połączenia.
+ */
+#define ACCEPT_BACKOFF 10
+
+/**
+ * To jest struktura przechowująca bufor danych połączenia.
+ */
+typedef struct Buffer {
+    unsigned char *data; ///< zawartość bufora
+    size_t size;         ///< rozmiar zaalokowanej pamięci
+    size_t start;        ///< początek nieprzetworzonych danych
+    size_t end;          ///< koniec danych
+} Buffer;
+
+/**
+ * To jest struktura przechowująca stan połączenia.
+ */
+typedef struct Connection {
+    int fd;        ///< deskryptor gniazda
+    Buffer input;  ///< odebrane i nieprzetworzone żądania
+    Buffer output; ///< niewysłane odpowiedzi
+    bool writing;  ///< czy połączenie czeka na możliwość zapisu
+} Connection;
+
+/**
+ * To jest struktura opisująca wątek roboczy.
+ */
+typedef struct Worker {
+    int epoll;              ///< deskryptor pętli zdarzeń wątku
+    PhoneForward const *pf; ///< obsługiwana baza przekierowań
+    pthread_t id;           ///< identyfikator wątku
+} Worker;
+
+/** @brief Zapewnia miejsce w buforze.
+ * Przesuwa dane na początek bufora i w razie potrzeby go powiększa, tak aby
+ * zmieściło się w nim jeszcze @p needed bajtów.
+ * @param[in,out] buffer – wskaźnik na bufor;
+ * @param[in] needed – liczba potrzebnych bajtów.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool reserve(Buffer *buffer, size_t needed) {
+    if (buffer->start > 0 && buffer->size - buffer->end < needed) {
+        memmove(buffer->data, buffer->data + buffer->start,
+                buffer->end - buffer->start);
+        buffer->end -= buffer->start;
+        buffer->start = 0;
+    }
+    if (buffer->size - buffer->end >= needed)
+        return true;
+    size_t size = buffer->size == 0 ? READ_SIZE : buffer->size;
+    while (size - buffer->end < needed)
+        size *= 2;
+    unsigned char *ptr = realloc(buffer->data, size);
+    if (ptr == NULL)
+        return false;
+    buffer->data = ptr;
+    buffer->size = size;
+    return true;
+}
+
+/** @brief Dopisuje odpowiedź do bufora.
+ * @param[in,out] output – wskaźnik na bufor odpowiedzi;
+ * @param[in] pnum – wskaźnik na ciąg numerów lub NULL w przypadku błędu.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool appendResponse(Buffer *output, PhoneNumbers const *pnum) {
+    size_t count = 0, length = PROTO_RESPONSE_HEADER;
+    char const *number;
+    while (pnum != NULL && (number = phnumGet(pnum, count)) != NULL) {
+        size_t size = strlen(number);
+        if (size > PROTO_MAX_LENGTH) {
+            pnum = NULL;
+            length = PROTO_RESPONSE_HEADER;
+            break;
+        }
+        length += 2 + size;
+        count++;
+    }
+    if (!reserve(output, length))
+        return false;
+    unsigned char *position = output->data + output->end;
+    protoPut32(position, pnum == NULL ? PROTO_ERROR : (uint32_t) count);
+    position += PROTO_RESPONSE_HEADER;
+    for (size_t i = 0; pnum != NULL && i < count; i++) {
+        number = phnumGet(pnum, i);
+        size_t size = strlen(number);
+        protoPut16(position, (uint16_t) size);
+        memcpy(position + 2, number, size);
+        position += 2 + size;
+    }
+    output->end += length;
+    return true;
+}
+
+/** @brief Wykonuje odebrane żądania.
+ * Wykonuje wszystkie kompletne żądania z bufora wejściowego połączenia
+ * i dopisuje odpowiedzi na nie do bufora wyjściowego.
+ * @param[in] pf – wskaźnik na bazę przekierowań;
+ * @param[in,out] connection – wskaźnik na połączenie.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli żądanie było
+ *         niepoprawne lub nie udało się alokować pamięci.
+ */
+static bool handleRequests(PhoneForward const *pf, Connection *connection) {
+    Buffer *input = &connection->input;
+    char number[PROTO_MAX_LENGTH + 1];
+    while (input->end - input->start >= PROTO_REQUEST_HEADER &&
+           connection->output.end - connection->output.start < OUTPUT_LIMIT) {
+        unsigned char *request = input->data + input->start;
+        size_t length = protoGet16(request + 1);
+        if (input->end - input->start < PROTO_REQUEST_HEADER + length)
+            break;
+        memcpy(number, request + PROTO_REQUEST_HEADER, length);
+        number[length] = '\0';
+        PhoneNumbers *pnum;
+        switch (request[0]) {
+            case PROTO_GET:
+                pnum = phfwdGet(pf, number);
+                break;
+            case PROTO_REVERSE:
+                pnum = phfwdReverse(pf, number);
+                break;
+            case PROTO_GET_REVERSE:
+                pnum = phfwdGetReverse(pf, number);
+                break;
+            default:
+                return false;
+        }
+        bool ok = appendResponse(&connection->output, pnum);
+        phnumDelete(pnum);
+        if (!ok)
+            return false;
+        input->start += PROTO_REQUEST_HEADER + length;
+    }
+    if (input->start == input->end)
+        input->start = input->end = 0;
+    return true;
+}
+
+/** @brief Zamyka połączenie.
+ * @param[in] connection – wskaźnik na zamykane połączenie.
+ */
+static void closeConnection(Connection *connection) {
+    close(connection->fd);
+    free(connection->input.data);
+    free(connection->output.data);
+    free(connection);
+}
+
+/** @brief Wysyła odpowiedzi.
+ * Wysyła tyle odpowiedzi, ile gniazdo przyjmie bez blokowania, i ustawia
+ * zdarzenia, na które czeka połączenie.
+ * @param[in] epoll – deskryptor pętli zdarzeń;
+ * @param[in,out] connection – wskaźnik na połączenie.
+ * @return Wartość @p true, jeśli się udało, lub @p false w przypadku błędu.
+ */
+static bool flush(int epoll, Connection *connection) {
+    Buffer *output = &connection->output;
+    while (output->start < output->end) {
+        ssize_t sent = send(connection->fd, output->data + output->start,
+                            output->end - output->start, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (sent < 0)
+            return false;
+        output->start += (size_t) sent;
+    }
+    if (output->start == output->end)
+        output->start = output->end = 0;
+    bool writing = output->start < output->end;
+    if (writing != connection->writing) {
+        struct epoll_event event;
+        event.events = writing ? EPOLLOUT : EPOLLIN;
+        event.data.ptr = connection;
+        if (epoll_ctl(epoll, EPOLL_CTL_MOD, connection->fd, &event) != 0)
+            return false;
+        connection->writing = writing;
+    }
+    return true;
+}
+
+/** @brief Obsługuje zdarzenie połączenia.
+ * @param[in] worker – wskaźnik na wątek roboczy;
+ * @param[in,out] connection – wskaźnik na połączenie;
+ * @param[in] events – zgłoszone zdarzenia.
+ * @return Wartość @p true, jeśli połączenie pozostaje otwarte, lub @p false,
+ *         jeśli należy je zamknąć.
+ */
+static bool handleEvent(Worker *worker, Connection *connection,
+                        uint32_t events) {
+    if (events & (EPOLLERR | EPOLLHUP) && !(events & EPOLLIN))
+        return false;
+    if (events & EPOLLIN) {
+        for (;;) {
+            if (!reserve(&connection->input, READ_SIZE))
+                return false;
+            Buffer *input = &connection->input;
+            ssize_t received = recv(connection->fd, input->data + input->end,
+                                    input->size - input->end, 0);
+            if (received < 0 && errno == EINTR)
+                continue;
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            if (received <= 0)
+                return false;
+            input->end += (size_t) received;
+            if (input->end < input->size)
+                break;
+        }
+    }
+    // Pętla kończy się, gdy wszystkie kompletne żądania zostały wykonane lub
+    // gdy klient nie odbiera odpowiedzi. Żądania wstrzymane przez pełny bufor
+    // odpowiedzi są wykonywane po jego opróżnieniu, bo klient mógł już
+    // wysłać wszystko i czekać tylko na odpowiedzi.
+    for (;;) {
+        size_t before = connection->input.start;
+        bool full = connection->output.end - connection->output.start >=
+                    OUTPUT_LIMIT;
+        if (!handleRequests(worker->pf, connection) ||
+            !flush(worker->epoll, connection))
+            return false;
+        if (connection->writing ||
+            (connection->input.start == before && !full))
+            break;
+    }
+    return true;
+}
+
+/** @brief Wykonuje pętlę zdarzeń wątku roboczego.
+ * @param[in] data – wskaźnik na strukturę typu Worker.
+ * @return NULL.
+ */
+static void *workerLoop(void *data) {
+    Worker *worker = data;
+    struct epoll_event events[MAX_EVENTS];
+    for (;;) {
+        int count = epoll_wait(worker->epoll, events, MAX_EVENTS, -1);
+        for (int i = 0; i < count; i++) {
+            Connection *connection = events[i].data.ptr;
+            if (!handleEvent(worker, connection, events[i].events)) {
+                epoll_ctl(worker->epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+                closeConnection(connection);
+            }
+        }
+    }
+    return NULL;
+}
+
+/** @brief Otwiera gniazdo nasłuchujące.
+ * @param[in] text – napis reprezentujący adres serwera.
+ * @return Deskryptor gniazda lub -1 w przypadku błędu.
+ */
+static int openListener(char const *text) {
+    ProtoAddress address;
+    if (protoAddress(text, &address) != 0)
+        return -1;
+    int fd = socket(address.family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    int one = 1;
+    if (address.family == AF_UNIX)
+        unlink(text);
+    else
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    if (bind(fd, (struct sockaddr *) &address.address, address.length) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** @brief Odrzuca połączenie, na które zabrakło deskryptora.
+ * Oczekujące połączenie wciąż wybudzałoby accept4, więc zamyka zapasowy
+ * deskryptor, przyjmuje na jego miejsce połączenie i od razu je zamyka.
+ * Jeśli to się nie uda, czeka chwilę na zwolnienie deskryptorów.
+ * @param[in] listener – deskryptor gniazda nasłuchującego;
+ * @param[in,out] spare – wskaźnik na zapasowy deskryptor lub -1.
+ */
+static void rejectConnection(int listener, int *spare) {
+    int fd = -1;
+    if (*spare >= 0) {
+        close(*spare);
+        fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+        if (fd >= 0)
+            close(fd);
+        *spare = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0)
+        poll(NULL, 0, ACCEPT_BACKOFF);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Użycie: %s MIGAWKA ADRES [WĄTKI]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    long workers = argc == 4 ? strtol(argv[3], NULL, 10)
+                             : sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers < 1)
+        workers = 1;
+    if (workers > MAX_WORKERS)
+        workers = MAX_WORKERS;
+
+    PhoneForward *pf = phfwdLoad(argv[1]);
+    if (pf == NULL) {
+        fprintf(stderr, "Nie udało się wczytać migawki %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    // Zapytania są obsługiwane z kopii w pamięci węzła NUMA wątku; jeśli
+    // nie udało się ich utworzyć, z drzew.
+    if (!phfwdPublish(pf))
+        fprintf(stderr, "Nie udało się opublikować migawki.\n");
+    int listener = openListener(argv[2]);
+    if (listener < 0) {
+        perror(argv[2]);
+        phfwdDelete(pf);
+        return EXIT_FAILURE;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    int spare = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    Worker pool[MAX_WORKERS];
+    for (long w = 0; w < workers; w++) {
+        pool[w].pf = pf;
+        pool[w].epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (pool[w].epoll < 0 ||
+            pthread_create(&pool[w].id, NULL, workerLoop, &pool[w]) != 0) {
+            perror("worker");
+            return EXIT_FAILURE;
+        }
+    }
+    fprintf(stderr, "Serwer nasłuchuje na %s (%ld wątków).\n", argv[2],
+            workers);
+
+    for (long next = 0;; next = (next + 1) % workers) {
+        int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EMFILE || errno == ENFILE) {
+                rejectConnection(listener, &spare);
+                continue;
+            }
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("accept");
+            break;
+        }
+        Connection *connection = calloc(1, sizeof(Connection));
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (connection == NULL) {
+            close(fd);
+            continue;
+        }
+        connection->fd = fd;
+        if (epoll_ctl(pool[next].epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+            closeConnection(connection);
+    }
+    close(listener);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,141 @@
+/** @file
+ * Binarny protokół serwera przekierowań numerów telefonów.
+ *
+ * Żądanie składa się z jednego bajtu z kodem operacji, dwóch bajtów
+ * z długością numeru i samego numeru (bez znaku '\0'). Odpowiedź składa się
+ * z czterech bajtów z liczbą numerów, po których następują kolejne numery,
+ * każdy poprzedzony dwoma bajtami z długością. Liczby są zapisywane w
+ * kolejności little-endian. Klient może wysłać wiele żądań bez czekania na
+ * odpowiedzi; odpowiedzi przychodzą w kolejności żądań.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_NUMBERS_PROTOCOL_H
+#define PHONE_NUMBERS_PROTOCOL_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * Kod operacji @ref phfwdGet.
+ */
+#define PROTO_GET 1
+
+/**
+ * Kod operacji @ref phfwdReverse.
+ */
+#define PROTO_REVERSE 2
+
+/**
+ * Kod operacji @ref phfwdGetReverse.
+ */
+#define PROTO_GET_REVERSE 3
+
+/**
+ * Rozmiar nagłówka żądania.
+ */
+#define PROTO_REQUEST_HEADER 3
+
+/**
+ * Rozmiar nagłówka odpowiedzi.
+ */
+#define PROTO_RESPONSE_HEADER 4
+
+/**
+ * Maksymalna długość numeru w żądaniu i odpowiedzi.
+ */
+#define PROTO_MAX_LENGTH UINT16_MAX
+
+/**
+ * Liczba numerów w odpowiedzi oznaczająca błąd serwera.
+ */
+#define PROTO_ERROR UINT32_MAX
+
+/** @brief Zapisuje liczbę dwubajtową.
+ * @param[out] buffer – miejsce zapisu;
+ * @param[in] value – zapisywana liczba.
+ */
+static inline void protoPut16(unsigned char *buffer, uint16_t value) {
+    buffer[0] = (unsigned char) value;
+    buffer[1] = (unsigned char) (value >> 8);
+}
+
+/** @brief Zapisuje liczbę czterobajtową.
+ * @param[out] buffer – miejsce zapisu;
+ * @param[in] value – zapisywana liczba.
+ */
+static inline void protoPut32(unsigned char *buffer, uint32_t value) {
+    for (size_t i = 0; i < 4; i++)
+        buffer[i] = (unsigned char) (value >> (8 * i));
+}
+
+/** @brief Odczytuje liczbę dwubajtową.
+ * @param[in] buffer – miejsce odczytu.
+ * @return Odczytana liczba.
+ */
+static inline uint16_t protoGet16(unsigned char const *buffer) {
+    return (uint16_t) (buffer[0] | buffer[1] << 8);
+}
+
+/** @brief Odczytuje liczbę czterobajtową.
+ * @param[in] buffer – miejsce odczytu.
+ * @return Odczytana liczba.
+ */
+static inline uint32_t protoGet32(unsigned char const *buffer) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; i++)
+        value |= (uint32_t) buffer[i] << (8 * i);
+    return value;
+}
+
+/**
+ * To jest struktura przechowująca adres gniazda serwera.
+ */
+typedef struct ProtoAddress {
+    union {
+        struct sockaddr_un local; ///< adres gniazda lokalnego
+        struct sockaddr_in inet;  ///< adres gniazda sieciowego
+    } address;                    ///< adres gniazda
+    socklen_t length;             ///< długość adresu
+    int family;                   ///< rodzina adresów gniazda
+} ProtoAddress;
+
+/** @brief Odczytuje adres serwera.
+ * Napis złożony z samych cyfr oznacza numer portu na adresie pętli zwrotnej
+ * (127.0.0.1), każdy inny napis – ścieżkę gniazda lokalnego.
+ * @param[in] text – napis reprezentujący adres;
+ * @param[out] address – wskaźnik na odczytany adres.
+ * @return Wartość 0, jeśli adres jest poprawny, lub -1 w przeciwnym razie.
+ */
+static inline int protoAddress(char const *text, ProtoAddress *address) {
+    memset(address, 0, sizeof *address);
+    if (text[0] != '\0' && strspn(text, "0123456789") == strlen(text)) {
+        long port = strtol(text, NULL, 10);
+        if (port < 1 || port > UINT16_MAX)
+            return -1;
+        address->family = AF_INET;
+        address->address.inet.sin_family = AF_INET;
+        address->address.inet.sin_port = htons((uint16_t) port);
+        address->address.inet.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address->length = sizeof address->address.inet;
+    } else {
+        if (strlen(text) >= sizeof address->address.local.sun_path)
+            return -1;
+        address->family = AF_UNIX;
+        address->address.local.sun_family = AF_UNIX;
+        strcpy(address->address.local.sun_path, text);
+        address->length = sizeof address->address.local;
+    }
+    return 0;
+}
+
+#endif //PHONE_NUMBERS_PROTOCOL_H
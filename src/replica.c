@@ -0,0 +1,222 @@
+/** @file
+ * Implementacja kopii zamrożonych drzew rozmieszczonych w węzłach NUMA.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#define _GNU_SOURCE
+
+#include <limits.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "replica.h"
+
+/**
+ * Rozmiar dużej strony.
+ */
+#define HUGE_PAGE ((size_t) 2 * 1024 * 1024)
+
+/**
+ * Maksymalna liczba obsługiwanych węzłów NUMA.
+ */
+#define MAX_NODES 64
+
+/**
+ * Maksymalna liczba obsługiwanych procesorów.
+ */
+#define MAX_CPUS 4096
+
+/**
+ * Katalog z opisem węzłów NUMA.
+ */
+#define NODE_PATH "/sys/devices/system/node"
+
+/**
+ * Polityka przydziału pamięci z preferowanego węzła (MPOL_PREFERRED).
+ */
+#define POLICY_PREFERRED 1
+
+/**
+ * To jest implementacja struktury przechowującej kopie zamrożonych drzew.
+ */
+struct Replicas {
+    size_t count;           ///< liczba węzłów NUMA
+    size_t size;            ///< rozmiar odwzorowania każdej kopii
+    size_t cpuCount;        ///< liczba pozycji tablicy @p cpuNode
+    unsigned char *cpuNode; ///< węzeł NUMA każdego procesora lub NULL
+    Frozen *copies[];       ///< kopie w kolejnych węzłach lub NULL
+};
+
+/** @brief Wczytuje listę numerów z pliku.
+ * Wczytuje listę w formacie jądra, np. 0-3,8,10-11, i zaznacza wymienione
+ * w niej numery.
+ * @param[in] path – ścieżka do pliku;
+ * @param[out] items – tablica zaznaczonych numerów;
+ * @param[in] max – rozmiar tablicy @p items.
+ * @return Największy zaznaczony numer powiększony o 1 lub 0, jeśli nie
+ *         zaznaczono żadnego.
+ */
+static size_t readList(char const *path, bool *items, size_t max) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return 0;
+    size_t end = 0;
+    unsigned first, last;
+    while (fscanf(file, "%u", &first) == 1) {
+        last = first;
+        int separator = getc(file);
+        if (separator == '-') {
+            if (fscanf(file, "%u", &last) != 1)
+                break;
+            separator = getc(file);
+        }
+        for (size_t i = first; i <= last && i < max; i++) {
+            items[i] = true;
+            end = i + 1;
+        }
+        if (separator != ',')
+            break;
+    }
+    fclose(file);
+    return end;
+}
+
+/** @brief Tworzy kopię zamrożonych drzew w węźle NUMA.
+ * Odwzorowuje obszar wyrównany do rozmiaru dużej strony, prosi o umieszczenie
+ * go na dużych stronach w pamięci węzła @p node i kopiuje do niego drzewa.
+ * Pamięć jest przydzielana przy pierwszym zapisie, czyli już zgodnie z tymi
+ * wskazówkami.
+ * @param[in] frozen – wskaźnik na kopiowane drzewa;
+ * @param[in] size – rozmiar odwzorowania, wielokrotność dużej strony;
+ * @param[in] node – numer węzła NUMA;
+ * @param[in] bind – czy wskazać węzeł NUMA.
+ * @return Wskaźnik na kopię lub NULL, gdy nie udało się odwzorować pamięci.
+ */
+static Frozen *mapCopy(Frozen const *frozen, size_t size, size_t node,
+                       bool bind) {
+    char *memory = mmap(NULL, size + HUGE_PAGE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return NULL;
+    size_t head = (HUGE_PAGE - (uintptr_t) memory % HUGE_PAGE) % HUGE_PAGE;
+    if (head > 0)
+        munmap(memory, head);
+    munmap(memory + head + size, HUGE_PAGE - head);
+    char *copy = memory + head;
+#ifdef MADV_HUGEPAGE
+    madvise(copy, size, MADV_HUGEPAGE);
+#endif
+#ifdef SYS_mbind
+    if (bind) {
+        unsigned long mask = 1UL << node;
+        syscall(SYS_mbind, copy, size, POLICY_PREFERRED, &mask,
+                sizeof mask * CHAR_BIT, 0);
+    }
+#else
+    (void) node;
+    (void) bind;
+#endif
+    memcpy(copy, frozen, frozenSize(frozen));
+    mprotect(copy, size, PROT_READ);
+    return (Frozen *) copy;
+}
+
+/** @brief Ustala węzły NUMA procesorów.
+ * @param[in,out] replicas – wskaźnik na strukturę;
+ * @param[in] online – tablica działających węzłów NUMA.
+ */
+static void mapCpus(Replicas *replicas, bool const *online) {
+    bool *cpus = malloc(MAX_CPUS * sizeof(bool));
+    replicas->cpuNode = calloc(MAX_CPUS, sizeof(unsigned char));
+    if (cpus == NULL || replicas->cpuNode == NULL) {
+        free(cpus);
+        free(replicas->cpuNode);
+        replicas->cpuNode = NULL;
+        return;
+    }
+    for (size_t node = 0; node < replicas->count; node++) {
+        if (!online[node])
+            continue;
+        char path[sizeof NODE_PATH + 48];
+        snprintf(path, sizeof path, NODE_PATH "/node%zu/cpulist", node);
+        memset(cpus, 0, MAX_CPUS * sizeof(bool));
+        size_t end = readList(path, cpus, MAX_CPUS);
+        for (size_t cpu = 0; cpu < end; cpu++)
+            if (cpus[cpu])
+                replicas->cpuNode[cpu] = (unsigned char) node;
+        if (end > replicas->cpuCount)
+            replicas->cpuCount = end;
+    }
+    free(cpus);
+}
+
+Replicas *replicasNew(Frozen const *frozen) {
+    bool online[MAX_NODES] = {false};
+    size_t count = readList(NODE_PATH "/online", online, MAX_NODES);
+    if (count == 0) {
+        count = 1;
+        online[0] = true;
+    }
+    Replicas *replicas = malloc(sizeof(Replicas) + count * sizeof(Frozen *));
+    if (replicas == NULL)
+        return NULL;
+    replicas->count = count;
+    replicas->size = (frozenSize(frozen) + HUGE_PAGE - 1) / HUGE_PAGE *
+                     HUGE_PAGE;
+    replicas->cpuCount = 0;
+    replicas->cpuNode = NULL;
+    for (size_t node = 0; node < count; node++)
+        replicas->copies[node] = NULL;
+    for (size_t node = 0; node < count; node++) {
+        if (node > 0 && !online[node])
+            continue;
+        replicas->copies[node] = mapCopy(frozen, replicas->size, node,
+                                         count > 1);
+        if (replicas->copies[node] == NULL) {
+            replicasDelete(replicas);
+            return NULL;
+        }
+    }
+    if (count > 1)
+        mapCpus(replicas, online);
+    return replicas;
+}
+
+void replicasDelete(Replicas *replicas) {
+    if (replicas != NULL) {
+        for (size_t node = 0; node < replicas->count; node++)
+            if (replicas->copies[node] != NULL)
+                munmap(replicas->copies[node], replicas->size);
+        free(replicas->cpuNode);
+        free(replicas);
+    }
+}
+
+size_t replicasCount(Replicas const *replicas) {
+    size_t count = 0;
+    for (size_t node = 0; node < replicas->count; node++)
+        if (replicas->copies[node] != NULL)
+            count++;
+    return count;
+}
+
+Frozen const *replicasLocal(Replicas const *replicas) {
+    if (replicas->cpuNode != NULL) {
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && (size_t) cpu < replicas->cpuCount) {
+            Frozen const *local = replicas->copies[replicas->cpuNode[cpu]];
+            if (local != NULL)
+                return local;
+        }
+    }
+    return replicas->copies[0];
+}
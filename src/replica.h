@@ -0,0 +1,50 @@
+/** @file
+ * Interfejs kopii zamrożonych drzew rozmieszczonych w węzłach NUMA.
+ *
+ * @author Sara Łukasik <sa.lukasik@student.uw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef PHONE_NUMBERS_REPLICA_H
+#define PHONE_NUMBERS_REPLICA_H
+
+#include <stddef.h>
+#include "frozen.h"
+
+/**
+ * To jest struktura przechowująca kopie zamrożonych drzew, po jednej
+ * w pamięci każdego węzła NUMA.
+ */
+typedef struct Replicas Replicas;
+
+/** @brief Tworzy kopie zamrożonych drzew.
+ * Kopiuje @p frozen do pamięci każdego węzła NUMA systemu. Kopie leżą na
+ * dużych stronach, jeśli system na to pozwala. Jeśli nie da się ustalić
+ * węzłów NUMA, tworzy jedną kopię.
+ * @param[in] frozen – wskaźnik na kopiowane drzewa.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+Replicas *replicasNew(Frozen const *frozen);
+
+/** @brief Usuwa kopie zamrożonych drzew.
+ * Nic nie robi, jeśli @p replicas ma wartość NULL.
+ * @param[in] replicas – wskaźnik na usuwaną strukturę.
+ */
+void replicasDelete(Replicas *replicas);
+
+/** @brief Podaje liczbę kopii.
+ * @param[in] replicas – wskaźnik na strukturę.
+ * @return Liczba kopii zamrożonych drzew.
+ */
+size_t replicasCount(Replicas const *replicas);
+
+/** @brief Podaje kopię najbliższą wywołującemu wątkowi.
+ * @param[in] replicas – wskaźnik na strukturę.
+ * @return Wskaźnik na kopię leżącą w pamięci węzła NUMA procesora, na którym
+ *         działa wątek, lub na pierwszą kopię, jeśli nie da się go ustalić.
+ */
+Frozen const *replicasLocal(Replicas const *replicas);
+
+#endif //PHONE_NUMBERS_REPLICA_H
@@ -7,11 +7,18 @@
  * @date 2022
  */
 
+#define _DEFAULT_SOURCE
+
 #include <assert.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include "tree.h"
 #include <stdarg.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
 
 void multiFree(unsigned int count, ...) {
     va_list list;
@@ -22,33 +29,501 @@ void multiFree(unsigned int count, ...) {
     va_end(list);
 }
 
-Node *nodeNew(Node *parent, size_t index) {
-    Node *new = malloc(1 * sizeof(Node));
+void *memoryAlloc(Memory *memory, size_t size) {
+    if (!memoryFits(memory, size))
+        return NULL;
+    void *ptr = memory->allocate != NULL
+                ? memory->allocate(size, memory->data)
+                : malloc(size);
+    if (ptr == NULL)
+        return NULL;
+    memory->live += size;
+    if (memory->live > memory->peak)
+        memory->peak = memory->live;
+    return ptr;
+}
+
+void memoryFree(Memory *memory, void *ptr, size_t size) {
+    if (ptr == NULL)
+        return;
+    memory->live -= size;
+    if (memory->release != NULL)
+        memory->release(ptr, size, memory->data);
+    else
+        free(ptr);
+}
+
+bool memoryFits(Memory const *memory, size_t size) {
+    return memory->budget == 0 || (memory->live <= memory->budget &&
+                                   size <= memory->budget - memory->live);
+}
+
+/**
+ * Znacznik napisu zaalokowanego funkcją memoryAlloc.
+ */
+#define STRING_HEAP 0
+
+/**
+ * Znacznik napisu umieszczonego w obszarze przez nodeCompact.
+ */
+#define STRING_PACKED 1
+
+/**
+ * Znacznik napisu umieszczonego w puli krótkich numerów.
+ */
+#define STRING_POOLED 2
+
+/**
+ * Rozmiar bloku puli. Blok zaczyna się nagłówkiem, a reszta jest dzielona na
+ * miejsca jednej klasy.
+ */
+#define SLAB_SIZE ((size_t) 4096)
+
+/**
+ * Rozmiar miejsca najmniejszej klasy puli; każda kolejna ma dwa razy większe.
+ */
+#define POOL_SLOT ((size_t) 8)
+
+/**
+ * Rozmiar obszaru, w którym umieszczane są węzły przy kompaktowaniu drzewa.
+ * Obszary są wyrównane do swojego rozmiaru, więc początek obszaru można
+ * wyznaczyć z adresu dowolnego leżącego w nim węzła.
+ */
+#define ARENA_SIZE ((size_t) 2 * 1024 * 1024)
+
+/**
+ * Liczba najwyższych poziomów drzewa układanych w pamięci wszerz.
+ */
+#define COMPACT_TOP_LEVELS 3
+
+/**
+ * To jest nagłówek bloku puli krótkich numerów. Miejsca bloku następują
+ * bezpośrednio po nagłówku.
+ */
+typedef struct Slab {
+    struct Slab *next; ///< następny blok puli lub NULL
+    size_t kind;       ///< klasa miejsc bloku
+} Slab;
+
+/**
+ * To jest nagłówek obszaru pamięci przechowującego węzły ułożone przez
+ * @ref nodeCompact. Węzły następują bezpośrednio po nagłówku.
+ */
+typedef struct Arena {
+    size_t live;    ///< liczba nieusuniętych węzłów w obszarze
+    size_t used;    ///< liczba zajętych bajtów obszaru, wliczając nagłówek
+} Arena;
+
+size_t nodeSize(size_t width) {
+    return sizeof(Node) + width * sizeof(Node *);
+}
+
+/** @brief Zwalnia miejsce w obszarze.
+ * Zmniejsza liczbę nieusuniętych elementów obszaru, w którym leży @p ptr,
+ * i zwalnia obszar, jeśli nie ma już w nim żadnego.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] ptr – wskaźnik na węzeł lub napis w obszarze.
+ */
+static void arenaFree(Memory *memory, void *ptr) {
+    Arena *arena = (Arena *) ((uintptr_t) ptr & ~(ARENA_SIZE - 1));
+    arena->live--;
+    if (arena->live == 0) {
+        munmap(arena, ARENA_SIZE);
+        memory->live -= ARENA_SIZE;
+    }
+}
+
+void nodeFree(Memory *memory, Node *node) {
+    if (node == NULL)
+        return;
+    if (node->packed)
+        arenaFree(memory, node);
+    else
+        memoryFree(memory, node, nodeSize(node->width));
+}
+
+/** @brief Wyznacza klasę puli dla napisu.
+ * @param[in] size – liczba bajtów napisu wraz ze znacznikiem.
+ * @return Numer najmniejszej klasy, której miejsca mieszczą @p size bajtów,
+ *         lub POOL_CLASSES, jeśli napis jest za duży na pulę.
+ */
+static size_t poolClass(size_t size) {
+    size_t kind = 0;
+    while (kind < POOL_CLASSES && (POOL_SLOT << kind) < size)
+        kind++;
+    return kind;
+}
+
+/** @brief Dodaje do puli nowy blok.
+ * Przydziela blok i wstawia wszystkie jego miejsca na listę wolnych miejsc
+ * klasy @p kind.
+ * @param[in,out] memory – wskaźnik na opis pamięci;
+ * @param[in] kind – numer klasy.
+ * @return Wartość @p true, jeśli się udało, lub @p false, jeśli nie udało się
+ *         alokować pamięci.
+ */
+static bool slabNew(Memory *memory, size_t kind) {
+    Slab *slab = memoryAlloc(memory, SLAB_SIZE);
+    if (slab == NULL)
+        return false;
+    slab->next = memory->slabs;
+    slab->kind = kind;
+    memory->slabs = slab;
+    size_t slot = POOL_SLOT << kind;
+    for (size_t offset = sizeof(Slab); offset + slot <= SLAB_SIZE;
+         offset += slot) {
+        void **place = (void **) ((char *) slab + offset);
+        *place = memory->pool[kind];
+        memory->pool[kind] = place;
+    }
+    return true;
+}
+
+/** @brief Przydziela miejsce na napis.
+ * Napisy mieszczące się w miejscach puli pobiera z puli, a pozostałe
+ * przydziela funkcją @ref memoryAlloc. Zapisuje w pierwszym bajcie
+ * odpowiedni znacznik.
+ * @param[in,out] memory – wskaźnik na opis pamięci;
+ * @param[in] size – liczba bajtów napisu wraz ze znacznikiem.
+ * @return Wskaźnik na znacznik napisu lub NULL, jeśli nie udało się alokować
+ *         pamięci.
+ */
+static Number *stringAlloc(Memory *memory, size_t size) {
+    size_t kind = poolClass(size);
+    if (kind == POOL_CLASSES) {
+        Number *str = memoryAlloc(memory, size);
+        if (str != NULL)
+            str[0] = STRING_HEAP;
+        return str;
+    }
+    if (memory->pool[kind] == NULL && !slabNew(memory, kind))
+        return NULL;
+    void **place = memory->pool[kind];
+    memory->pool[kind] = *place;
+    memory->pooled++;
+    Number *str = (Number *) place;
+    str[0] = STRING_POOLED;
+    return str;
+}
+
+void memoryMerge(Memory *memory, Memory *other) {
+    memory->live += other->live;
+    memory->pooled += other->pooled;
+    if (memory->live > memory->peak)
+        memory->peak = memory->live;
+    for (size_t kind = 0; kind < POOL_CLASSES; kind++) {
+        void **last = &other->pool[kind];
+        while (*last != NULL)
+            last = *last;
+        *last = memory->pool[kind];
+        memory->pool[kind] = other->pool[kind];
+    }
+    Slab **last = (Slab **) &other->slabs;
+    while (*last != NULL)
+        last = &(*last)->next;
+    *last = memory->slabs;
+    memory->slabs = other->slabs;
+}
+
+/** @brief Porównuje adresy bloków puli.
+ * @param[in] val1 – wskaźnik na wskaźnik na pierwszy blok;
+ * @param[in] val2 – wskaźnik na wskaźnik na drugi blok.
+ * @return Wartość ujemna, 0 lub dodatnia, jeśli pierwszy blok leży
+ *         odpowiednio przed, w tym samym miejscu lub za drugim.
+ */
+static int compareSlabs(const void *val1, const void *val2) {
+    uintptr_t a = (uintptr_t) *(Slab *const *) val1;
+    uintptr_t b = (uintptr_t) *(Slab *const *) val2;
+    return (a > b) - (a < b);
+}
+
+/** @brief Szuka bloku puli zawierającego miejsce.
+ * @param[in] slabs – tablica bloków posortowana według adresów;
+ * @param[in] count – liczba bloków;
+ * @param[in] place – wskaźnik na miejsce w jednym z bloków.
+ * @return Indeks bloku zawierającego @p place.
+ */
+static size_t findSlab(Slab *const *slabs, size_t count, void const *place) {
+    size_t low = 0, high = count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if ((uintptr_t) slabs[middle] <= (uintptr_t) place)
+            low = middle;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/** @brief Podaje liczbę miejsc bloku puli danej klasy.
+ * @param[in] kind – numer klasy.
+ * @return Liczba miejsc w jednym bloku.
+ */
+static size_t slabSlots(size_t kind) {
+    return (SLAB_SIZE - sizeof(Slab)) / (POOL_SLOT << kind);
+}
+
+/** @brief Przenosi numer z opróżnianego bloku puli.
+ * Jeśli numer leży w puli, w bloku oznaczonym do zwolnienia, kopiuje go
+ * w wolne miejsce tej samej klasy z listy wolnych miejsc. Miejsca te leżą
+ * wyłącznie w blokach, które pozostają.
+ * @param[in,out] memory – wskaźnik na opis pamięci;
+ * @param[in] str – wskaźnik na numer lub NULL;
+ * @param[in] slabs – tablica bloków posortowana według adresów;
+ * @param[in] count – liczba bloków;
+ * @param[in] victims – tablica znaczników bloków do zwolnienia.
+ * @return Wskaźnik na numer po przeniesieniu.
+ */
+static Number *repackString(Memory *memory, Number *str, Slab *const *slabs,
+                            size_t count, bool const *victims) {
+    if (str == NULL || str[-1] != STRING_POOLED)
+        return str;
+    size_t i = findSlab(slabs, count, str - 1);
+    if (!victims[i])
+        return str;
+    size_t kind = slabs[i]->kind;
+    void **place = memory->pool[kind];
+    assert(place != NULL);
+    memory->pool[kind] = *place;
+    memcpy(place, str - 1, POOL_SLOT << kind);
+    return (Number *) place + 1;
+}
+
+/** @brief Przenosi numery drzewa z opróżnianych bloków puli.
+ * Odwiedza wszystkie węzły drzewa, wraz z drzewami przechowywanymi w polach
+ * @p backward, i przenosi ich numery funkcją @ref repackString.
+ * @param[in,out] memory – wskaźnik na opis pamięci;
+ * @param[in] root – wskaźnik na korzeń drzewa lub NULL;
+ * @param[in] slabs – tablica bloków posortowana według adresów;
+ * @param[in] count – liczba bloków;
+ * @param[in] victims – tablica znaczników bloków do zwolnienia.
+ */
+static void repackTree(Memory *memory, Node *root, Slab *const *slabs,
+                       size_t count, bool const *victims) {
+    if (root == NULL)
+        return;
+    Node *node = root;
+    size_t i = 0;
+    for (;;) {
+        if (i == 0) {
+            node->mine = repackString(memory, node->mine, slabs, count,
+                                      victims);
+            node->value = repackString(memory, node->value, slabs, count,
+                                       victims);
+            repackTree(memory, node->backward, slabs, count, victims);
+        }
+        while (i < node->width && node->numbers[i] == NULL)
+            i++;
+        if (i == node->width) {
+            if (node == root)
+                break;
+            i = node->index + 1;
+            node = node->parent;
+        } else {
+            node = node->numbers[i];
+            i = 0;
+        }
+    }
+}
+
+/** @brief Opróżnia i zwalnia najmniej zajęte bloki puli.
+ * Zlicza wolne miejsca każdego bloku i w każdej klasie oznacza do zwolnienia
+ * bloki o najmniejszej liczbie numerów, dopóki numery te mieszczą się
+ * w wolnych miejscach pozostałych bloków. Usuwa miejsca oznaczonych bloków
+ * z list wolnych miejsc, przenosi ich numery z drzew @p roots i zwalnia
+ * oznaczone bloki. Jeśli nie uda się alokować pamięci pomocniczej, nic nie
+ * robi.
+ * @param[in,out] memory – wskaźnik na opis pamięci;
+ * @param[in] roots – tablica korzeni drzew zawierających wszystkie numery
+ *                    z puli;
+ * @param[in] trees – liczba drzew.
+ */
+static void trimSlabs(Memory *memory, Node *const *roots, size_t trees) {
+    size_t count = 0;
+    for (Slab *slab = memory->slabs; slab != NULL; slab = slab->next)
+        count++;
+    Slab **slabs = malloc(count * sizeof(Slab *));
+    size_t *unused = calloc(count, sizeof(size_t));
+    bool *victims = calloc(count, sizeof(bool));
+    size_t *used = calloc(slabSlots(0) + 1, sizeof(size_t));
+    if (slabs == NULL || unused == NULL || victims == NULL || used == NULL) {
+        multiFree(4, slabs, unused, victims, used);
+        return;
+    }
+    count = 0;
+    for (Slab *slab = memory->slabs; slab != NULL; slab = slab->next)
+        slabs[count++] = slab;
+    qsort(slabs, count, sizeof(Slab *), compareSlabs);
+    for (size_t kind = 0; kind < POOL_CLASSES; kind++)
+        for (void **place = memory->pool[kind]; place != NULL; place = *place)
+            unused[findSlab(slabs, count, place)]++;
+    bool moves = false;
+    for (size_t kind = 0; kind < POOL_CLASSES; kind++) {
+        // Zwalniamy bloki o co najwyżej limit numerach dla największego
+        // progu, przy którym ich numery zmieszczą się w pozostałych blokach.
+        // Bez drzew nie da się przenosić numerów, więc tylko puste bloki.
+        size_t slots = slabSlots(kind), spare = 0;
+        memset(used, 0, (slots + 1) * sizeof(size_t));
+        for (size_t i = 0; i < count; i++)
+            if (slabs[i]->kind == kind) {
+                used[slots - unused[i]]++;
+                spare += unused[i];
+            }
+        size_t limit = 0, moved = 0;
+        spare -= used[0] * slots;
+        while (trees > 0 && limit < slots &&
+               moved + used[limit + 1] * slots <= spare) {
+            limit++;
+            moved += used[limit] * limit;
+            spare -= used[limit] * (slots - limit);
+        }
+        for (size_t i = 0; i < count; i++)
+            if (slabs[i]->kind == kind && slots - unused[i] <= limit) {
+                victims[i] = true;
+                moves = moves || unused[i] < slots;
+            }
+        void **last = &memory->pool[kind];
+        while (*last != NULL) {
+            if (victims[findSlab(slabs, count, *last)])
+                *last = *(void **) *last;
+            else
+                last = *last;
+        }
+    }
+    for (size_t i = 0; moves && i < trees; i++)
+        repackTree(memory, roots[i], slabs, count, victims);
+    Slab **last = (Slab **) &memory->slabs;
+    while (*last != NULL) {
+        Slab *slab = *last;
+        if (victims[findSlab(slabs, count, slab)]) {
+            *last = slab->next;
+            memoryFree(memory, slab, SLAB_SIZE);
+        } else {
+            last = &slab->next;
+        }
+    }
+    multiFree(4, slabs, unused, victims, used);
+}
+
+void memoryTrim(Memory *memory, Node *const *roots, size_t count) {
+    if (memory->pooled > 0) {
+        trimSlabs(memory, roots, count);
+        return;
+    }
+    while (memory->slabs != NULL) {
+        Slab *slab = memory->slabs;
+        memory->slabs = slab->next;
+        memoryFree(memory, slab, SLAB_SIZE);
+    }
+    for (size_t kind = 0; kind < POOL_CLASSES; kind++)
+        memory->pool[kind] = NULL;
+}
+
+size_t stringSize(char const *str) {
+    return numberSize(strlen(str)) + 1;
+}
+
+size_t stringsCost(Memory const *memory, unsigned int count, ...) {
+    size_t cost = 0, needed[POOL_CLASSES] = {0};
+    va_list list;
+    va_start(list, count);
+    for (size_t j = 0; j < count; j++) {
+        size_t size = stringSize(va_arg(list, char const *));
+        size_t kind = poolClass(size);
+        if (kind == POOL_CLASSES)
+            cost += size;
+        else
+            needed[kind]++;
+    }
+    va_end(list);
+    for (size_t kind = 0; kind < POOL_CLASSES; kind++) {
+        void *const *place = memory->pool[kind];
+        while (needed[kind] > 0 && place != NULL) {
+            place = *place;
+            needed[kind]--;
+        }
+        if (needed[kind] > 0)
+            cost += SLAB_SIZE;
+    }
+    return cost;
+}
+
+Number *stringNew(Memory *memory, char const *str) {
+    assert(str != NULL);
+    Number *copy = stringAlloc(memory, stringSize(str));
+    if (copy == NULL)
+        return NULL;
+    numberEncode(copy + 1, str, "");
+    return copy + 1;
+}
+
+Number *stringCopy(Memory *memory, Number const *str) {
+    assert(str != NULL);
+    size_t bytes = numberBytes(str);
+    Number *copy = stringAlloc(memory, bytes + 1);
+    if (copy == NULL)
+        return NULL;
+    memcpy(copy + 1, str, bytes);
+    return copy + 1;
+}
+
+void stringFree(Memory *memory, Number *str) {
+    if (str == NULL)
+        return;
+    if (str[-1] == STRING_PACKED) {
+        arenaFree(memory, str);
+    } else if (str[-1] == STRING_POOLED) {
+        void **place = (void **) (str - 1);
+        size_t kind = poolClass(numberBytes(str) + 1);
+        *place = memory->pool[kind];
+        memory->pool[kind] = place;
+        memory->pooled--;
+    } else {
+        memoryFree(memory, str - 1, numberBytes(str) + 1);
+    }
+}
+
+void multiStringFree(Memory *memory, unsigned int count, ...) {
+    va_list list;
+    va_start(list, count);
+    for (size_t j = 0; j < count; j++) {
+        stringFree(memory, va_arg(list, Number *));
+    }
+    va_end(list);
+}
+
+Node *nodeNew(Memory *memory, Node *parent, size_t index, size_t width) {
+    assert(width <= DIGITS);
+    Node *new = memoryAlloc(memory, nodeSize(width));
     if (new == NULL)
         return NULL;
-    for (size_t i = 0; i < DIGITS; i++)
+    for (size_t i = 0; i < width; i++)
         new->numbers[i] = NULL;
 
     new->value = NULL;
     new->mine = NULL;
     new->backward = NULL;
     new->parent = parent;
-    new->index = index;
+    new->hash = 0;
+    new->index = (unsigned char) index;
+    new->width = (unsigned char) width;
+    new->packed = false;
     return new;
 }
 
-void completeDelete(Node *node) {
+void completeDelete(Memory *memory, Node *node) {
     if (node != NULL) {
         Node *end = node->parent;
         while (node != end) {
             size_t i = 0;
-            while (i < DIGITS && node->numbers[i] == NULL)
+            while (i < node->width && node->numbers[i] == NULL)
                 i++;
-            if (i == DIGITS) {
+            if (i == node->width) {
                 Node *next = node->parent;
                 if (node->backward != NULL)
-                    completeDelete(node->backward);
-                multiFree(3, node->value, node->mine, node);
+                    completeDelete(memory, node->backward);
+                multiStringFree(memory, 2, node->value, node->mine);
+                nodeFree(memory, node);
                 node = next;
             } else {
                 Node *next = node->numbers[i];
@@ -59,89 +534,277 @@ void completeDelete(Node *node) {
     }
 }
 
+/**
+ * Wartości cyfr numeru, indeksowane znakami. Pozostałe znaki mają wartość 0.
+ */
+static unsigned char const digitValues[1 << CHAR_BIT] = {
+        ['0'] = 0, ['1'] = 1, ['2'] = 2, ['3'] = 3, ['4'] = 4, ['5'] = 5,
+        ['6'] = 6, ['7'] = 7, ['8'] = 8, ['9'] = 9, [TEN] = 10, [ELEVEN] = 11
+};
+
 size_t digitFinder(char num) {
-    if (num == TEN)
-        return 10;
-    else if (num == ELEVEN)
-        return 11;
-    else return num - '0';
+    return digitValues[(unsigned char) num];
+}
+
+char digitChar(size_t digit) {
+    assert(digit < DIGITS);
+    if (digit == 10)
+        return TEN;
+    else if (digit == 11)
+        return ELEVEN;
+    else return (char) ('0' + digit);
+}
+
+uint64_t forwardHash(Number const *num1, Number const *num2) {
+    // FNV-1a dla bajtów obu spakowanych numerów i mieszanie bitów jak
+    // w splitmix64, aby sumy skrótów różnych zbiorów przekierowań rzadko
+    // były równe. Długość na początku numeru rozdziela oba numery.
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (size_t i = 0, bytes = numberBytes(num1); i < bytes; i++)
+        hash = (hash ^ num1[i]) * UINT64_C(1099511628211);
+    for (size_t i = 0, bytes = numberBytes(num2); i < bytes; i++)
+        hash = (hash ^ num2[i]) * UINT64_C(1099511628211);
+    hash ^= hash >> 30;
+    hash *= UINT64_C(0xbf58476d1ce4e5b9);
+    hash ^= hash >> 27;
+    hash *= UINT64_C(0x94d049bb133111eb);
+    return hash ^ (hash >> 31);
+}
+
+void nodeAddHash(Node *node, uint64_t delta) {
+    for (; node != NULL; node = node->parent)
+        node->hash += delta;
 }
 
+bool isItNumber(char const *number) {
+    if (number == NULL)
+        return false;
+    if (number[0] == '\0')
+        return false;
+    size_t i = 0;
+    while (isdigit(number[i]) || number[i] == TEN || number[i] == ELEVEN)
+        i++;
+    if (number[i] == '\0')
+        return true;
+    else
+        return false;
+}
+
+bool fitsAlphabet(char const *number, size_t width) {
+    for (; number[0] != '\0'; number++)
+        if (digitFinder(number[0]) >= width)
+            return false;
+    return true;
+}
+
+/** @brief Sprawdza, czy cyfra należy do alfabetu drzewa.
+ * Dla pełnego alfabetu warunek jest zawsze prawdziwy, więc znika przy
+ * kompilacji funkcji utworzonych przez @ref TREE_WALKS.
+ * @param[in] digit – wartość cyfry;
+ * @param[in] width – stała liczba cyfr alfabetu drzewa.
+ */
+#define IN_ALPHABET(digit, width) ((width) == DIGITS || (digit) < (width))
+
+/** @brief Tworzy funkcje przechodzące drzewa o zadanym alfabecie.
+ * Definiuje funkcje findNode, findNumberNode, findOrCreateNode,
+ * findOrCreateNumberNode, findNodeToRemove, findLongest, findLongestNumber
+ * i nodeForEach z sufiksem @p suffix dla drzew, których węzły mają @p width
+ * synów. Szerokość alfabetu jest stałą, więc w pętlach
+ * po cyfrach numeru nie trzeba odczytywać jej z węzłów.
+ * @param[in] suffix – sufiks nazw funkcji;
+ * @param[in] width – liczba cyfr alfabetu drzewa.
+ */
+#define TREE_WALKS(suffix, width)                                             \
+static Node *findNode##suffix(Node *node, char const *num) {                  \
+    for (; num[0] != '\0'; num++) {                                           \
+        size_t digit = digitFinder(num[0]);                                   \
+        if (!IN_ALPHABET(digit, width) || node->numbers[digit] == NULL)       \
+            return NULL;                                                      \
+        node = node->numbers[digit];                                          \
+    }                                                                         \
+    return node;                                                              \
+}                                                                             \
+                                                                              \
+static Node *findNumberNode##suffix(Node *node, Number const *num) {          \
+    size_t length = numberLength(num);                                        \
+    for (size_t i = 0; i < length && node != NULL; i++) {                     \
+        size_t digit = numberDigit(num, i);                                   \
+        node = IN_ALPHABET(digit, width) ? node->numbers[digit] : NULL;       \
+    }                                                                         \
+    return node;                                                              \
+}                                                                             \
+                                                                              \
+static Node *findOrCreateNode##suffix(Memory *memory, Node *node,             \
+                                      char const *num) {                      \
+    for (; num[0] != '\0'; num++) {                                           \
+        size_t digit = digitFinder(num[0]);                                   \
+        if (!IN_ALPHABET(digit, width))                                       \
+            return NULL;                                                      \
+        if (node->numbers[digit] == NULL) {                                   \
+            node->numbers[digit] = nodeNew(memory, node, digit, width);       \
+            if (node->numbers[digit] == NULL)                                 \
+                return NULL;                                                  \
+        }                                                                     \
+        node = node->numbers[digit];                                          \
+    }                                                                         \
+    return node;                                                              \
+}                                                                             \
+                                                                              \
+static Node *findOrCreateNumberNode##suffix(Memory *memory, Node *node,       \
+                                            Number const *num,                \
+                                            size_t start) {                   \
+    size_t length = numberLength(num);                                        \
+    for (size_t i = start; i < length && node != NULL; i++) {                 \
+        size_t digit = numberDigit(num, i);                                   \
+        if (!IN_ALPHABET(digit, width))                                       \
+            return NULL;                                                      \
+        if (node->numbers[digit] == NULL)                                     \
+            node->numbers[digit] = nodeNew(memory, node, digit, width);       \
+        node = node->numbers[digit];                                          \
+    }                                                                         \
+    return node;                                                              \
+}                                                                             \
+                                                                              \
+static Node *findNodeToRemove##suffix(Node *node, char const *num) {          \
+    size_t digit = digitFinder(num[0]);                                       \
+    while (IN_ALPHABET(digit, width) && node->numbers[digit] != NULL &&       \
+           num[1] != '\0') {                                                  \
+        node = node->numbers[digit];                                          \
+        num = num + 1;                                                        \
+        digit = digitFinder(num[0]);                                          \
+    }                                                                         \
+    if (num[1] != '\0' || !IN_ALPHABET(digit, width))                         \
+        return NULL;                                                          \
+    Node *to_return = node->numbers[digit];                                   \
+    node->numbers[digit] = NULL;                                              \
+    return to_return;                                                         \
+}                                                                             \
+                                                                              \
+static Node *findLongest##suffix(Node *node, char const **num) {              \
+    Node *longest = node;                                                     \
+    char const *sufix = *num;                                                 \
+    for (char const *rest = *num;; rest++) {                                  \
+        if (node->value != NULL) {                                            \
+            longest = node;                                                   \
+            sufix = rest;                                                     \
+        }                                                                     \
+        size_t digit = digitFinder(rest[0]);                                  \
+        if (rest[0] == '\0' || !IN_ALPHABET(digit, width) ||                  \
+            node->numbers[digit] == NULL)                                     \
+            break;                                                            \
+        node = node->numbers[digit];                                          \
+    }                                                                         \
+    *num = sufix;                                                             \
+    return longest;                                                           \
+}                                                                             \
+                                                                              \
+static Node *findLongestNumber##suffix(Node *node, Number const *num,         \
+                                       size_t *depth) {                       \
+    Node *longest = node;                                                     \
+    size_t length = numberLength(num);                                        \
+    *depth = 0;                                                               \
+    for (size_t i = 0;; i++) {                                                \
+        if (node->value != NULL) {                                            \
+            longest = node;                                                   \
+            *depth = i;                                                       \
+        }                                                                     \
+        if (i == length)                                                      \
+            break;                                                            \
+        size_t digit = numberDigit(num, i);                                   \
+        if (!IN_ALPHABET(digit, width) || node->numbers[digit] == NULL)       \
+            break;                                                            \
+        node = node->numbers[digit];                                          \
+    }                                                                         \
+    return longest;                                                           \
+}                                                                             \
+                                                                              \
+static bool nodeForEach##suffix(Node *node,                                   \
+                                bool (*visit)(Node *node, void *data),        \
+                                void *data) {                                 \
+    Node *end = node->parent;                                                 \
+    size_t i = 0;                                                             \
+    while (node != end) {                                                     \
+        if (i == 0 && node->value != NULL && !visit(node, data))              \
+            return false;                                                     \
+        while (i < width && node->numbers[i] == NULL)                         \
+            i++;                                                              \
+        if (i == width) {                                                     \
+            i = node->index + 1;                                              \
+            node = node->parent;                                              \
+        } else {                                                              \
+            node = node->numbers[i];                                          \
+            i = 0;                                                            \
+        }                                                                     \
+    }                                                                         \
+    return true;                                                              \
+}
+
+TREE_WALKS(Full, DIGITS)
+
+TREE_WALKS(Decimal, DECIMAL_DIGITS)
+
 Node *findNode(Node *node, char const *num) {
-    size_t digit = digitFinder(num[0]);
-    while (num[0] != '\0') {
-        assert(digit <= 11);
-        if (node->numbers[digit] == NULL) {
-            return NULL;
-        }
-        node = node->numbers[digit];
-        num = num + 1;
-        digit = digitFinder(num[0]);
-    }
-    return node;
+    assert(node->width == DIGITS || node->width == DECIMAL_DIGITS);
+    return node->width == DIGITS ? findNodeFull(node, num)
+                                 : findNodeDecimal(node, num);
 }
 
+Node *findNumberNode(Node *node, Number const *num) {
+    assert(num != NULL);
+    if (node == NULL)
+        return NULL;
+    return node->width == DIGITS ? findNumberNodeFull(node, num)
+                                 : findNumberNodeDecimal(node, num);
+}
 
-Node *findOrCreateNode(Node *node, char const *num) {
+Node *findOrCreateNode(Memory *memory, Node *node, char const *num) {
     assert(num != NULL);
     if (node == NULL)
         return NULL;
-    size_t digit = digitFinder(num[0]);
-    while (num[0] != '\0') {
-        assert(digit <= 11);
-        if (node->numbers[digit] == NULL) {
-            node->numbers[digit] = nodeNew(node, digit);
-            if (node->numbers[digit] == NULL)
-                return NULL;
-        }
-        node = node->numbers[digit];
-        num = num + 1;
-        digit = digitFinder(num[0]);
-    }
-    return node;
+    return node->width == DIGITS ? findOrCreateNodeFull(memory, node, num)
+                                 : findOrCreateNodeDecimal(memory, node, num);
 }
 
+Node *findOrCreateNumberNode(Memory *memory, Node *node, Number const *num,
+                             size_t start) {
+    assert(num != NULL);
+    if (node == NULL)
+        return NULL;
+    return node->width == DIGITS
+           ? findOrCreateNumberNodeFull(memory, node, num, start)
+           : findOrCreateNumberNodeDecimal(memory, node, num, start);
+}
 
 Node *findNodeToRemove(Node *node, char const *num) {
     assert(num != NULL);
     if (node == NULL)
         return NULL;
-    size_t digit = digitFinder(num[0]);
-    while (node->numbers[digit] != NULL && num[1] != '\0') {
-        node = node->numbers[digit];
-        num = num + 1;
-        digit = digitFinder(num[0]);
-    }
-    if (num[1] == '\0') {
-        Node *to_return = node->numbers[digit];
-        node->numbers[digit] = NULL;
-        return to_return;
-    } else
-        return NULL;
+    return node->width == DIGITS ? findNodeToRemoveFull(node, num)
+                                 : findNodeToRemoveDecimal(node, num);
 }
 
 Node *findLongest(Node *node, const char **num) {
     assert(num != NULL);
     if (node == NULL)
         return NULL;
-    size_t digit = digitFinder(*num[0]);
-    Node *longest = node;
-    const char *sufix = *num;
-    while (*num[0] != '\0' && node->numbers[digit] != NULL) {
-        if (node->value != NULL) {
-            longest = node;
-            sufix = *num;
-        }
-        node = node->numbers[digit];
-        *num = *num + 1;
-        digit = digitFinder(*num[0]);
-    }
-    if (node->value != NULL) {
-        longest = node;
-        sufix = *num;
-    }
-    *num = sufix;
-    return longest;
+    return node->width == DIGITS ? findLongestFull(node, num)
+                                 : findLongestDecimal(node, num);
+}
+
+Node *findLongestNumber(Node *node, Number const *num, size_t *depth) {
+    assert(num != NULL && depth != NULL);
+    if (node == NULL)
+        return NULL;
+    return node->width == DIGITS ? findLongestNumberFull(node, num, depth)
+                                 : findLongestNumberDecimal(node, num, depth);
+}
+
+bool nodeForEach(Node *node, bool (*visit)(Node *node, void *data),
+                 void *data) {
+    if (node == NULL)
+        return true;
+    return node->width == DIGITS ? nodeForEachFull(node, visit, data)
+                                 : nodeForEachDecimal(node, visit, data);
 }
 
 /** @brief Sprawdza, czy zadany węzeł nie ma synów.
@@ -155,7 +818,7 @@ static inline bool isEmpty(Node *node) {
     if (node == NULL)
         return true;
     bool empty = true;
-    for (size_t i = 0; i < DIGITS; i++) {
+    for (size_t i = 0; i < node->width; i++) {
         if (node->numbers[i] != NULL) empty = false;
     }
     return empty;
@@ -164,16 +827,18 @@ static inline bool isEmpty(Node *node) {
 /** @brief Czyści drzewo.
  * Po usunięciu węzła w drzewie @p back funckja sprawdza, czy nie prowadziła
  * do niego nie wypełniona wartościami ścieżka i usuwa ją.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
  * @param[in] back – wskaźnik na strukturę reprezentującą drzewo numemerów;
  */
-static inline void backCleaner(Node *back) {
+static inline void backCleaner(Memory *memory, Node *back) {
     while (back->parent != NULL &&
            isEmpty(back->backward) &&
            isEmpty(back)) {
         Node *next_to_delete = back->parent;
         next_to_delete->numbers[back->index] = NULL;
-        multiFree(3, back->value, back->backward,
-                  back);
+        stringFree(memory, back->value);
+        nodeFree(memory, back->backward);
+        nodeFree(memory, back);
         back = next_to_delete;
     }
 }
@@ -181,37 +846,54 @@ static inline void backCleaner(Node *back) {
 /** @brief Czyści drzewo.
  * Po usunięciu węzła w drzewie @p node funckja sprawdza, czy nie prowadziła
  * do niego nie wypełniona wartościami ścieżka i usuwa ją.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
  * @param[in] node – wskaźnik na strukturę reprezentującą drzewo numemerów;
  */
-static inline void frontCleaner(Node *node) {
+static inline void frontCleaner(Memory *memory, Node *node) {
     while (node != NULL && node->parent != NULL && isEmpty(node) &&
            node->value == NULL) {
         Node *next = node->parent;
         next->numbers[node->index] = NULL;
-        multiFree(3, node->value, node->mine, node);
+        multiStringFree(memory, 2, node->value, node->mine);
+        nodeFree(memory, node);
+        node = next;
+    }
+}
+
+void nodePrune(Memory *memory, Node *node) {
+    while (node != NULL && node->parent != NULL && node->value == NULL &&
+           isEmpty(node) && isEmpty(node->backward)) {
+        Node *next = node->parent;
+        next->numbers[node->index] = NULL;
+        nodeFree(memory, node->backward);
+        nodeFree(memory, node);
         node = next;
     }
 }
 
-void nodeDelete(Node *node, Node *to) {
+void nodeDelete(Memory *memory, Node *node, Node *to) {
     if (node != NULL) {
         Node *end = node->parent;
         while (node != end) {
             size_t i = 0;
-            while (i < DIGITS && node->numbers[i] == NULL)
+            while (i < node->width && node->numbers[i] == NULL)
                 i++;
-            if (i == DIGITS) {
+            if (i == node->width) {
                 Node *next = node->parent;
                 if (to != NULL && node->value != NULL) {
-                    Node *back = findNode(to, node->value);
+                    Node *back = findNumberNode(to, node->value);
                     if (back != NULL) {
-                        Node *to_delete = findNodeToRemove(back->backward,
-                                                           node->mine);
-                        nodeDelete(to_delete, NULL);
-                        backCleaner(back);
+                        Node *to_delete = findNumberNode(back->backward,
+                                                         node->mine);
+                        if (to_delete != NULL)
+                            to_delete->parent->numbers[to_delete->index] =
+                                    NULL;
+                        nodeDelete(memory, to_delete, NULL);
+                        backCleaner(memory, back);
                     }
                 }
-                multiFree(3, node->value, node->mine, node);
+                multiStringFree(memory, 2, node->value, node->mine);
+                nodeFree(memory, node);
                 node = next;
             } else {
                 Node *next = node->numbers[i];
@@ -219,6 +901,178 @@ void nodeDelete(Node *node, Node *to) {
                 node = next;
             }
         }
-        frontCleaner(node);
+        frontCleaner(memory, node);
+    }
+}
+
+/** @brief Przydziela miejsce w obszarze.
+ * Przydziela miejsce na węzeł lub napis w bieżącym obszarze @p arena, a jeśli
+ * go zabraknie, zakłada nowy obszar. Miejsce jest wyrównane do rozmiaru
+ * wskaźnika.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in,out] arena – wskaźnik na bieżący obszar lub NULL;
+ * @param[in] size – liczba potrzebnych bajtów.
+ * @return Wskaźnik na przydzielone miejsce lub NULL w przypadku błędu
+ *         alokacji pamięci albo gdy @p size bajtów nie zmieściłoby się
+ *         nawet w pustym obszarze.
+ */
+static void *arenaAlloc(Memory *memory, Arena **arena, size_t size) {
+    size_t header = (sizeof(Arena) + sizeof(Node *) - 1) /
+                    sizeof(Node *) * sizeof(Node *);
+    if (size > ARENA_SIZE - header)
+        return NULL;
+    size = (size + sizeof(Node *) - 1) / sizeof(Node *) * sizeof(Node *);
+    if (*arena == NULL || (*arena)->used + size > ARENA_SIZE) {
+        if (!memoryFits(memory, ARENA_SIZE))
+            return NULL;
+        // Odwzorowujemy dwa razy większy obszar i oddajemy nadmiar
+        // przed i za jego wyrównaną częścią.
+        char *mapped = mmap(NULL, 2 * ARENA_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED)
+            return NULL;
+        size_t head = (ARENA_SIZE - (uintptr_t) mapped % ARENA_SIZE) %
+                      ARENA_SIZE;
+        if (head > 0)
+            munmap(mapped, head);
+        munmap(mapped + head + ARENA_SIZE, ARENA_SIZE - head);
+        Arena *new = (Arena *) (mapped + head);
+        new->live = 0;
+        new->used = header;
+        *arena = new;
+        memory->live += ARENA_SIZE;
+        if (memory->live > memory->peak)
+            memory->peak = memory->live;
+    }
+    void *place = (char *) *arena + (*arena)->used;
+    (*arena)->used += size;
+    (*arena)->live++;
+    return place;
+}
+
+/** @brief Przenosi numer do obszaru.
+ * Jeśli nie udało się alokować pamięci lub numer nie mieści się w obszarze,
+ * pozostaje na miejscu.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] str – wskaźnik na przenoszony numer lub NULL;
+ * @param[in,out] arena – wskaźnik na bieżący obszar.
+ * @return Wskaźnik na numer po przeniesieniu.
+ */
+static Number *relocateString(Memory *memory, Number *str, Arena **arena) {
+    if (str == NULL)
+        return NULL;
+    size_t bytes = numberBytes(str);
+    Number *copy = arenaAlloc(memory, arena, bytes + 1);
+    if (copy == NULL)
+        return str;
+    copy[0] = STRING_PACKED;
+    memcpy(copy + 1, str, bytes);
+    stringFree(memory, str);
+    return copy + 1;
+}
+
+/** @brief Przenosi węzeł do obszaru.
+ * Kopiuje węzeł @p node i jego napisy do bieżącego obszaru, zwalnia ich
+ * poprzednie miejsce i poprawia wskaźniki synów na rodzica oraz rodzica na
+ * węzeł.
+ * Jeśli nie udało się alokować pamięci, węzeł pozostaje na miejscu.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] node – wskaźnik na przenoszony węzeł;
+ * @param[in,out] arena – wskaźnik na bieżący obszar.
+ * @return Wskaźnik na węzeł po przeniesieniu.
+ */
+static Node *relocate(Memory *memory, Node *node, Arena **arena) {
+    Node *new = arenaAlloc(memory, arena, nodeSize(node->width));
+    if (new == NULL)
+        return node;
+    memcpy(new, node, nodeSize(node->width));
+    new->packed = true;
+    nodeFree(memory, node);
+    new->mine = relocateString(memory, new->mine, arena);
+    new->value = relocateString(memory, new->value, arena);
+    for (size_t i = 0; i < new->width; i++)
+        if (new->numbers[i] != NULL)
+            new->numbers[i]->parent = new;
+    if (new->parent != NULL)
+        new->parent->numbers[new->index] = new;
+    return new;
+}
+
+/** @brief Przenosi jeden poziom drzewa do obszaru.
+ * Przenosi, w porządku leksykograficznym, wszystkich synów węzłów leżących
+ * na głębokości @p level - 1.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] root – wskaźnik na korzeń drzewa;
+ * @param[in] level – głębokość przenoszonych węzłów, co najmniej 1;
+ * @param[in,out] arena – wskaźnik na bieżący obszar.
+ */
+static void relocateLevel(Memory *memory, Node *root, size_t level,
+                          Arena **arena) {
+    Node *node = root;
+    size_t depth = 0, i = 0;
+    for (;;) {
+        if (depth + 1 == level) {
+            for (size_t j = 0; j < node->width; j++)
+                if (node->numbers[j] != NULL)
+                    relocate(memory, node->numbers[j], arena);
+            i = node->width;
+        }
+        while (i < node->width && node->numbers[i] == NULL)
+            i++;
+        if (i == node->width) {
+            if (node == root)
+                break;
+            i = node->index + 1;
+            node = node->parent;
+            depth--;
+        } else {
+            node = node->numbers[i];
+            i = 0;
+            depth++;
+        }
+    }
+}
+
+/** @brief Przenosi drzewo do obszarów.
+ * Najwyższe poziomy drzewa układa wszerz, a poddrzewa poniżej nich w głąb,
+ * tak aby kolejne odwiedzane przy wyszukiwaniu węzły leżały blisko siebie.
+ * Drzewo przechowywane w polu @p backward węzła jest układane zaraz za nim.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] root – wskaźnik na korzeń drzewa;
+ * @param[in,out] arena – wskaźnik na bieżący obszar.
+ * @return Wskaźnik na korzeń drzewa po przeniesieniu.
+ */
+static Node *compactTree(Memory *memory, Node *root, Arena **arena) {
+    root = relocate(memory, root, arena);
+    for (size_t level = 1; level <= COMPACT_TOP_LEVELS; level++)
+        relocateLevel(memory, root, level, arena);
+    Node *node = root;
+    size_t depth = 0, i = 0;
+    for (;;) {
+        if (i == 0 && node->backward != NULL)
+            node->backward = compactTree(memory, node->backward, arena);
+        while (i < node->width && node->numbers[i] == NULL)
+            i++;
+        if (i == node->width) {
+            if (node == root)
+                break;
+            i = node->index + 1;
+            node = node->parent;
+            depth--;
+        } else {
+            node = node->numbers[i];
+            i = 0;
+            depth++;
+            if (depth > COMPACT_TOP_LEVELS)
+                node = relocate(memory, node, arena);
+        }
     }
+    return root;
+}
+
+Node *nodeCompact(Memory *memory, Node *root) {
+    if (root == NULL || memory->allocate != NULL)
+        return root;
+    Arena *arena = NULL;
+    return compactTree(memory, root, &arena);
 }
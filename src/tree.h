@@ -9,11 +9,21 @@
 #ifndef PHONE_NUMBERS_TREE_H
 #define PHONE_NUMBERS_TREE_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "number.h"
+
 /**
- * Liczba cyfr w systemie dziesiętnym.
+ * Liczba cyfr w pełnym alfabecie numerów (0–9, * i #).
  */
 #define DIGITS 12
 
+/**
+ * Liczba cyfr w alfabecie numerów dziesiętnych (0–9).
+ */
+#define DECIMAL_DIGITS 10
+
 /**
  * Oznaczenie cyfry 10
  */
@@ -27,31 +37,202 @@
 /**
  * To jest implementacja struktury reprezentującej węzeł drzewa
  * numerów telefonu.Posiada przekierowanie numeru i adresy
- * numerów,które go rozszerzają.
+ * numerów,które go rozszerzają. Tablica synów ma tyle elementów, ile cyfr
+ * ma alfabet drzewa, więc węzły drzew numerów dziesiętnych są mniejsze.
  */
 typedef struct Node {
-    struct Node *numbers[DIGITS];   ///< tablica struktur typu Node
     struct Node *backward;  ///< drzewo z numerami przekierowującymi
-    char *value;    ///< tablica wartości typu char, zawierająca przekierowanie
-    char *mine; ///< tablica wartości typu char, zawierająca numer telefonu
+    Number *value;  ///< spakowany numer, zawierający przekierowanie
+    Number *mine;   ///< spakowany numer, zawierający numer telefonu
     struct Node *parent;    ///< wskaźnik na rodzica węzła
-    size_t index;   ///<- oznaczenie, którym dzieckiem rodzica jest węzeł
+    uint64_t hash;  ///< suma skrótów przekierowań w poddrzewie węzła
+    unsigned char index;   ///<- oznaczenie, którym dzieckiem rodzica jest węzeł
+    unsigned char width;   ///< liczba cyfr alfabetu drzewa
+    bool packed;    ///< czy węzeł leży w obszarze utworzonym przez nodeCompact
+    struct Node *numbers[];   ///< tablica struktur typu Node
 } Node;
 
+/**
+ * Liczba klas rozmiarów puli krótkich numerów.
+ */
+#define POOL_CLASSES 2
+
+/**
+ * To jest struktura opisująca, skąd pochodzi pamięć na węzły i napisy drzew
+ * jednej struktury przekierowań, oraz liczniki jej zużycia. Krótkie numery
+ * są umieszczane w blokach puli, a nie przydzielane osobno.
+ */
+typedef struct Memory {
+    /** Funkcja przydzielająca @p size bajtów lub NULL dla funkcji malloc. */
+    void *(*allocate)(size_t size, void *data);
+    /** Funkcja zwalniająca @p size bajtów pod adresem @p ptr. */
+    void (*release)(void *ptr, size_t size, void *data);
+    void *data;    ///< argument przekazywany obu funkcjom
+    size_t budget; ///< największa dozwolona wartość @p live lub 0
+    size_t live;   ///< liczba przydzielonych bajtów
+    size_t peak;   ///< największa dotychczasowa wartość @p live
+    void *pool[POOL_CLASSES]; ///< listy wolnych miejsc kolejnych klas puli
+    void *slabs;   ///< lista bloków puli
+    size_t pooled; ///< liczba numerów umieszczonych w puli
+} Memory;
+
+/** @brief Przydziela pamięć.
+ * Przydziela pamięć funkcją @p memory->allocate i dolicza ją do liczników.
+ * @param[in,out] memory – wskaźnik na opis pamięci;
+ * @param[in] size – liczba bajtów.
+ * @return Wskaźnik na przydzieloną pamięć lub NULL, jeśli nie udało się jej
+ *         alokować albo przekroczyłaby limit @p memory->budget.
+ */
+void *memoryAlloc(Memory *memory, size_t size);
+
+/** @brief Zwalnia pamięć przydzieloną funkcją @ref memoryAlloc.
+ * @param[in,out] memory – wskaźnik na opis pamięci;
+ * @param[in] ptr – wskaźnik na zwalnianą pamięć;
+ * @param[in] size – liczba bajtów podana przy przydziale.
+ */
+void memoryFree(Memory *memory, void *ptr, size_t size);
+
+/** @brief Sprawdza, czy można przydzielić pamięć bez przekroczenia limitu.
+ * @param[in] memory – wskaźnik na opis pamięci;
+ * @param[in] size – liczba bajtów.
+ * @return Wartość @p true, jeśli @p size bajtów mieści się w limicie.
+ */
+bool memoryFits(Memory const *memory, size_t size);
+
+/** @brief Przejmuje pamięć innego opisu.
+ * Dolicza liczniki @p other do @p memory i przejmuje jego bloki puli, tak że
+ * numery przydzielone z @p other można zwalniać w @p memory. Opis @p other
+ * nie może być potem używany.
+ * @param[in,out] memory – wskaźnik na opis pamięci;
+ * @param[in,out] other – wskaźnik na przejmowany opis pamięci.
+ */
+void memoryMerge(Memory *memory, Memory *other);
+
+/** @brief Zwalnia bloki puli.
+ * Miejsca zwolnionych numerów pozostają w puli do ponownego użycia, więc
+ * bloki są oddawane dopiero przez tę funkcję, na przykład po usunięciu lub
+ * kompaktowaniu drzew. Zwalnia puste bloki, a numery z najmniej zajętych
+ * bloków przenosi w wolne miejsca pozostałych i zwalnia także te bloki.
+ * Koszt jest proporcjonalny do liczby wolnych miejsc puli i, jeśli trzeba
+ * przenosić numery, do rozmiaru drzew.
+ * @param[in,out] memory – wskaźnik na opis pamięci;
+ * @param[in] roots – tablica korzeni drzew, które razem zawierają wszystkie
+ *                    numery z puli, lub NULL;
+ * @param[in] count – liczba drzew; jeśli wynosi 0, zwalniane są tylko puste
+ *                    bloki.
+ */
+void memoryTrim(Memory *memory, Node *const *roots, size_t count);
+
 /** @brief Zwalnia przekazane w argumentach wskaźniki
  * Zwalnia @p count wskaźników przekazanych jako argumenty.
  * @param[in] count – ilość wskaźników do usunięcia.
  */
 void multiFree(unsigned int count, ...);
 
+/** @brief Pakuje numer przechowywany w drzewie.
+ * Tworzy spakowaną kopię numeru @p str, którą można umieścić w polu
+ * @p value lub @p mine węzła. Kopia musi być zwolniona funkcją
+ * @ref stringFree.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] str – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na spakowany numer lub NULL, jeśli nie udało się alokować
+ *         pamięci.
+ */
+Number *stringNew(Memory *memory, char const *str);
+
+/** @brief Kopiuje numer przechowywany w drzewie.
+ * Odpowiednik funkcji @ref stringNew dla spakowanego numeru.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] str – wskaźnik na spakowany numer.
+ * @return Wskaźnik na kopię numeru lub NULL, jeśli nie udało się alokować
+ *         pamięci.
+ */
+Number *stringCopy(Memory *memory, Number const *str);
+
+/** @brief Zwalnia numer przechowywany w drzewie.
+ * Zwalnia numer utworzony funkcją @ref stringNew, także jeśli został
+ * przeniesiony przez @ref nodeCompact. Miejsce numeru z puli wraca na listę
+ * wolnych miejsc. Nic nie robi, jeśli @p str ma wartość NULL.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] str – wskaźnik na zwalniany numer.
+ */
+void stringFree(Memory *memory, Number *str);
+
+/** @brief Podaje liczbę bajtów zajmowanych przez numer.
+ * @param[in] str – wskaźnik na napis reprezentujący numer.
+ * @return Liczba bajtów, które zajmie kopia @p str utworzona funkcją
+ *         @ref stringNew.
+ */
+size_t stringSize(char const *str);
+
+/** @brief Liczy pamięć potrzebną na kopie numerów.
+ * Liczy, o ile może wzrosnąć zajęta pamięć, gdy funkcją @ref stringNew
+ * zostaną utworzone kopie @p count numerów przekazanych jako argumenty.
+ * Numery mieszczące się w puli nic nie kosztują, jeśli w ich klasie
+ * zostało dość wolnych miejsc, a w przeciwnym razie kosztują nowy blok puli.
+ * @param[in] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] count – liczba numerów, co najwyżej tyle, ile miejsc ma blok.
+ * @return Liczba bajtów.
+ */
+size_t stringsCost(Memory const *memory, unsigned int count, ...);
+
+/** @brief Zwalnia przekazane w argumentach numery.
+ * Zwalnia funkcją @ref stringFree @p count numerów przekazanych jako
+ * argumenty.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] count – ilość napisów do usunięcia.
+ */
+void multiStringFree(Memory *memory, unsigned int count, ...);
+
 /** @brief Tworzy nową strukturę.
  * Tworzy nową strukturę typu Node, która nie posiada żadnych przekierowań.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
  * @param[in] parent – wskaźnik na rodzica węzła;
- * @param[in] index – numer węzła.
+ * @param[in] index – numer węzła;
+ * @param[in] width – liczba cyfr alfabetu drzewa (co najwyżej @ref DIGITS).
  * @return Wskaźnik na strukturę typu Node lub NULL w przypadku błędu
  *         alokacji pamięci.
  */
-Node *nodeNew(Node *parent, size_t index);
+Node *nodeNew(Memory *memory, Node *parent, size_t index, size_t width);
+
+/** @brief Podaje rozmiar węzła.
+ * @param[in] width – liczba cyfr alfabetu drzewa.
+ * @return Liczba bajtów zajmowanych przez węzeł.
+ */
+size_t nodeSize(size_t width);
+
+/** @brief Usuwa węzeł.
+ * Zwalnia pamięć zajmowaną przez węzeł @p node, ale nie przez jego napisy
+ * ani synów. Nic nie robi, jeśli @p node ma wartość NULL.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] node – wskaźnik na usuwany węzeł.
+ */
+void nodeFree(Memory *memory, Node *node);
+
+/** @brief Usuwa zbędną ścieżkę.
+ * Usuwa węzeł @p node i kolejnych jego przodków, dopóki nie są korzeniem
+ * i nie mają synów, wartości ani niepustego drzewa w polu @p backward.
+ * Pozwala wycofać węzły utworzone przez @ref findOrCreateNode, jeśli dalsza
+ * część operacji się nie powiodła.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] node – wskaźnik na węzeł lub NULL.
+ */
+void nodePrune(Memory *memory, Node *node);
+
+/** @brief Kompaktuje drzewo.
+ * Przenosi wszystkie węzły drzewa @p root i ich napisy, wraz z drzewami
+ * przechowywanymi w polach @p backward, do ciągłych obszarów pamięci, w kolejności
+ * sprzyjającej wyszukiwaniu: najwyższe poziomy wszerz, a niższe w głąb.
+ * Jeśli zabraknie pamięci, część węzłów pozostaje na swoich miejscach,
+ * a drzewo pozostaje poprawne. Numery większe od obszaru nie są
+ * przenoszone. Obszary są odwzorowywane bezpośrednio, więc drzewa,
+ * których pamięć przydziela funkcja @p memory->allocate, nie są
+ * przenoszone.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] root – wskaźnik na korzeń drzewa.
+ * @return Wskaźnik na korzeń drzewa po przeniesieniu.
+ */
+Node *nodeCompact(Memory *memory, Node *root);
 
 /** @brief Konwertuje cyfrę zapisaną jako char na int.
  * Przyjmuje jedną z cyfr, które mogą tworzyć numer telefonu i
@@ -60,6 +241,50 @@ Node *nodeNew(Node *parent, size_t index);
  * @return wartość typu size_t odpowiadająca przekazanej warotści typu char.*/
 size_t digitFinder(char num);
 
+/** @brief Konwertuje wartość cyfry na char.
+ * Funkcja odwrotna do @ref digitFinder.
+ * @param[in] digit – wartość cyfry, mniejsza od @ref DIGITS.
+ * @return Znak reprezentujący cyfrę.
+ */
+char digitChar(size_t digit);
+
+/** @brief Wylicza skrót przekierowania.
+ * @param[in] num1 – spakowany prefiks numerów przekierowywanych;
+ * @param[in] num2 – spakowany prefiks numerów, na które jest wykonywane
+ *                   przekierowanie.
+ * @return 64-bitowy skrót pary numerów.
+ */
+uint64_t forwardHash(Number const *num1, Number const *num2);
+
+/** @brief Zmienia skróty poddrzew.
+ * Dodaje @p delta (modulo 2^64) do skrótu węzła @p node i wszystkich jego
+ * przodków. Skrót poddrzewa jest sumą skrótów @ref forwardHash jego
+ * przekierowań, więc po zmianie przekierowania wystarczy poprawić skróty na
+ * ścieżce do korzenia.
+ * @param[in,out] node – wskaźnik na węzeł lub NULL;
+ * @param[in] delta – zmiana skrótu.
+ */
+void nodeAddHash(Node *node, uint64_t delta);
+
+/** @brief Sprawdza, czy tablica wartości typu char to poprawny numer.
+ * Sprawdza, czy tablica charów składa się z samych cyfr i kończy znakiem "\0".
+ * @param[in] number – wskaźnik na tablicę wartości typu char, która
+ *                     będzię sprawdzana.
+ * @return Wartość @p true, jeśli @p number jest wskaźnikiem na tablicę
+ *         poprawnie reprezentującą numer.
+ *         Wartość @p false,  jeśli @p number jest wskaźnikiem na tablicę
+ *         niepoprawnie reprezentującą numer.
+ */
+bool isItNumber(char const *number);
+
+/** @brief Sprawdza, czy numer należy do alfabetu drzewa.
+ * @param[in] number – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] width – liczba cyfr alfabetu drzewa.
+ * @return Wartość @p true, jeśli wszystkie cyfry numeru @p number są mniejsze
+ *         od @p width.
+ */
+bool fitsAlphabet(char const *number, size_t width);
+
 /** @brief Szuka węzła w drzewie numerów.
  * Szuka w drzewie numerów zadanego numeru. W przypadku nieznalezienia go,
  * zwraca null.
@@ -70,17 +295,40 @@ size_t digitFinder(char num);
  */
 Node *findNode(Node *node, char const *num);
 
+/** @brief Szuka węzła spakowanego numeru w drzewie numerów.
+ * Odpowiednik funkcji @ref findNode dla numeru przechowywanego w węźle.
+ * @param[in] node – wskaźnik na korzeń drzewa lub NULL;
+ * @param[in] num – wskaźnik na spakowany numer.
+ * @return Wskaźnik na węzeł reprezentujący numer @p num lub NULL, jeśli
+ *         @p node ma wartość NULL lub nie znaleziono węzła.
+ */
+Node *findNumberNode(Node *node, Number const *num);
+
 /** @brief Szuka lub tworzy węzeł w drzewie numerów.
  * Szuka w drzewie numerów zadanego numeru. W przypadku nieznalezienia go,
  * tworzy węzeł reprezentujący odpowiedni numer oraz w razie potrzeby węzły
  * stanowiące do niego ścieżkę.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
  * @param[in] node – wskaźnik na strukturę reprezentującą drzewo numemerów;
  * @param[in] num – tablica wartości typu char, reprezentująca numer telefonu.
  * @return Wskaźnik na węzeł reprezentujący zadany numer @p num lub
  *         NULL jeśli @p node
  * ma wartość NULL lub doszło do błędu alokacji pamięci.
  */
-Node *findOrCreateNode(Node *node, char const *num);
+Node *findOrCreateNode(Memory *memory, Node *node, char const *num);
+
+/** @brief Szuka lub tworzy węzeł spakowanego numeru w drzewie numerów.
+ * Odpowiednik funkcji @ref findOrCreateNode dla cyfr numeru @p num od
+ * pozycji @p start.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
+ * @param[in] node – wskaźnik na korzeń drzewa lub NULL;
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[in] start – pozycja pierwszej cyfry, co najwyżej długość numeru.
+ * @return Wskaźnik na węzeł lub NULL, jeśli @p node ma wartość NULL, cyfra
+ *         nie należy do alfabetu drzewa lub doszło do błędu alokacji pamięci.
+ */
+Node *findOrCreateNumberNode(Memory *memory, Node *node, Number const *num,
+                             size_t start);
 
 /** @brief Szuka węzła w drzewie numerów.
  * Szuka w drzewie numerów węzła reprezentującego zadany numer.
@@ -103,18 +351,44 @@ Node *findNodeToRemove(Node *node, char const *num);
  */
 Node *findLongest(Node *node, char const **num);
 
+/** @brief Szuka najdłuższej ścieżki w drzewie pasującej do spakowanego numeru.
+ * Odpowiednik funkcji @ref findLongest dla spakowanego numeru, który nie
+ * wymaga rozpakowania numeru.
+ * @param[in] node – wskaźnik na strukturę reprezentującą drzewo numerów;
+ * @param[in] num – wskaźnik na spakowany numer;
+ * @param[out] depth – liczba cyfr numeru na znalezionej ścieżce.
+ * @return Wskaźnik na węzeł reprezentujący najdłuższą ścieżkę, lub
+ *         NULL jeśli @p node ma wartość NULL.
+ */
+Node *findLongestNumber(Node *node, Number const *num, size_t *depth);
+
+/** @brief Przechodzi drzewo numerów.
+ * Odwiedza w porządku leksykograficznym wszystkie węzły poddrzewa @p node,
+ * które mają przypisaną wartość, i dla każdego z nich wywołuje @p visit.
+ * Przechodzenie kończy się wcześniej, jeśli @p visit zwróci @p false.
+ * @param[in] node – wskaźnik na korzeń przechodzonego poddrzewa;
+ * @param[in] visit – funkcja wywoływana dla odwiedzanych węzłów;
+ * @param[in] data – wskaźnik przekazywany do funkcji @p visit.
+ * @return Wartość @p true, jeśli odwiedzono wszystkie węzły, lub @p false,
+ *         jeśli @p visit przerwała przechodzenie.
+ */
+bool nodeForEach(Node *node, bool (*visit)(Node *node, void *data),
+                 void *data);
+
 /** @brief Usuwa strukturę typu Node.
  * Usuwa strukturę @p node oraz wyszstkie struktury Node, które są pod nią.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
  * @param[in] node – wskaźnik na strukturę, która ma być usunięta.
  */
-void completeDelete(Node *node);
+void completeDelete(Memory *memory, Node *node);
 
 /** @brief Usuwa strukturę typu Node.
  * Usuwa strukturę @p node oraz wyszstkie struktury Node, które są pod nią.
+ * @param[in,out] memory – wskaźnik na opis pamięci drzewa;
  * @param[in] node – wskaźnik na strukturę, która ma być usunięta.
  * @param[in] to - wskażnik na strukturę przechowującą numery odpowiadające
  *                 przekierowaniom
  */
-void nodeDelete(Node *node, Node *to);
+void nodeDelete(Memory *memory, Node *node, Node *to);
 
 #endif //PHONE_NUMBERS_TREE_H
\ No newline at end of file